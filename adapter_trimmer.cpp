@@ -0,0 +1,89 @@
+#include <algorithm>
+
+#include <string.h>
+
+#include "adapter_trimmer.h"
+#include "stringops.h"
+
+// Base of each 2-bit code, the inverse of base_code()
+static const char BASES[] = "ACGT";
+
+AdapterTrimmer::AdapterTrimmer(const std::string& adapter_1, const std::string& adapter_2){
+  adapters_[0] = adapter_1;
+  adapters_[1] = adapter_2;
+  matcher_.pack(adapters_[0], adapter_words_[0]);
+
+  // Complemented but not reversed, as the second reads are scanned from their ends
+  std::string complement = adapter_2;
+  reverse_complement(complement);
+  std::reverse(complement.begin(), complement.end());
+  matcher_.pack(complement, adapter_words_[1]);
+}
+
+int AdapterTrimmer::find(int read, const StringView& seq){
+  int adapter_len = adapters_[read].size();
+  if (adapter_len == 0)
+    return 0;
+
+  StringView target = seq;
+  if (read == 1){
+    reversed_.assign(seq.data, seq.size);
+    std::reverse(reversed_.begin(), reversed_.end());
+    target = StringView(reversed_);
+  }
+  matcher_.pack(target, read_words_);
+
+  for (int pos = 0; pos + MIN_OVERLAP <= target.size; pos++){
+    int length = std::min(adapter_len, target.size - pos);
+    int limit  = length/10;
+    if (matcher_.mismatches(read_words_.data(), pos, adapter_words_[read].data(), length, limit) <= limit)
+      return target.size - pos;
+  }
+  return 0;
+}
+
+AdapterInference::AdapterInference(){
+  counts_[0].assign(4*MAX_LENGTH, 0);
+  counts_[1].assign(4*MAX_LENGTH, 0);
+  num_pairs_ = 0;
+}
+
+bool AdapterInference::add_pair(const StringView& read_1, const StringView& read_2){
+  if (memchr(read_1.data, 'N', read_1.size) != NULL || memchr(read_2.data, 'N', read_2.size) != NULL)
+    return false;
+  matcher_.pack(read_1, words_1_);
+  matcher_.pack(read_2, words_2_);
+
+  // The longest fragment at which the start of the first read matches the end of the second is the pair's fragment
+  int max_fragment = std::min(read_1.size, read_2.size) - 1;
+  for (int fragment = max_fragment; fragment >= MIN_FRAGMENT; fragment--){
+    int limit = fragment/10;
+    if (matcher_.mismatches(words_2_.data(), read_2.size - fragment, words_1_.data(), fragment, limit) > limit)
+      continue;
+
+    // The first read continues into its adapter, and the second read's adapter precedes the fragment in reverse complement
+    for (int j = 0; j < MAX_LENGTH && fragment + j < read_1.size; j++)
+      counts_[0][4*j + base_code(read_1[fragment + j])]++;
+    for (int j = 0; j < MAX_LENGTH && read_2.size - fragment - 1 - j >= 0; j++)
+      counts_[1][4*j + 3 - base_code(read_2[read_2.size - fragment - 1 - j])]++;
+    num_pairs_++;
+    return true;
+  }
+  return false;
+}
+
+std::string AdapterInference::adapter(int read){
+  std::string adapter;
+  for (int j = 0; j < MAX_LENGTH; j++){
+    const int64_t* counts = counts_[read].data() + 4*j;
+    int64_t total = counts[0] + counts[1] + counts[2] + counts[3];
+    int best = std::max_element(counts, counts+4) - counts;
+    // Stops at the first position without a clear majority, which is usually where the evidence runs out
+    if (total < MIN_SUPPORT || 5*counts[best] < 4*total)
+      break;
+    adapter += BASES[best];
+  }
+  if ((int)adapter.size() < MIN_LENGTH)
+    adapter.clear();
+  return adapter;
+}
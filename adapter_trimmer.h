@@ -0,0 +1,71 @@
+#ifndef ADAPTER_TRIMMER_H
+#define ADAPTER_TRIMMER_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "bitparallel_matcher.h"
+#include "string_view.h"
+
+/*
+ * Removes adapter read-through from the 3' ends of the reads of a pair, so that it never reaches the overlap search.
+ * The adapter starts at the leftmost position where the rest of the read, or the whole adapter if it's shorter,
+ * matches the start of the adapter with at most one mismatch per ten bases. Partial adapters of at least MIN_OVERLAP
+ * bases at the very end of a read are removed as well. Reads and adapters are packed 2 bits per base and compared
+ * with BitParallelMatcher's popcount kernels.
+ *
+ * Second reads are reverse complemented when they're read, which moves their adapter to their start. They're scanned
+ * in reverse against the complemented adapter, which is the same as scanning the read as sequenced
+ */
+class AdapterTrimmer {
+ private:
+  std::string adapters_[2];
+  std::vector<uint64_t> adapter_words_[2];
+  std::vector<uint64_t> read_words_;
+  std::string reversed_;
+  BitParallelMatcher matcher_;
+
+ public:
+  const static int MIN_OVERLAP = 3;
+
+  /* Adapters are given as sequenced. An empty adapter leaves its reads untrimmed */
+  AdapterTrimmer(const std::string& adapter_1, const std::string& adapter_2);
+
+  const std::string& adapter(int read){ return adapters_[read]; }
+
+  /* Number of adapter bases at the 3' end of a first (read = 0) or reverse complemented second (read = 1) read */
+  int find(int read, const StringView& seq);
+};
+
+/*
+ * Infers the adapters from read-through pairs, whose fragments are shorter than their reads. Once the fragment the
+ * reads share is aligned, whatever extends past it in each read is adapter, and the per-position consensus of those
+ * tails over many pairs is taken as the adapter sequence
+ */
+class AdapterInference {
+ private:
+  std::vector<int64_t> counts_[2];  // Occurrences of each base at each adapter position, 4 per position
+  std::vector<uint64_t> words_1_, words_2_;
+  BitParallelMatcher matcher_;
+  int64_t num_pairs_;
+
+ public:
+  const static int MAX_LENGTH    = 40;  // Longest adapter prefix that's inferred
+  const static int MIN_LENGTH    = 10;  // Shorter consensus sequences aren't reported
+  const static int MIN_FRAGMENT  = 20;  // Shortest fragment whose alignment is trusted
+  const static int MIN_SUPPORT   = 20;  // Read-through pairs needed to call a base
+
+  AdapterInference();
+
+  /* Adds a pair whose second read has been reverse complemented. Returns true if it's a read-through pair */
+  bool add_pair(const StringView& read_1, const StringView& read_2);
+
+  int64_t num_pairs(){ return num_pairs_; }
+
+  /* Consensus adapter of the first (read = 0) or second (read = 1) reads as sequenced, or "" if there's too little evidence */
+  std::string adapter(int read);
+};
+
+#endif
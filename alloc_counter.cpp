@@ -0,0 +1,28 @@
+#include <new>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "profiler.h"
+
+/*
+ * Replacement operator new that counts allocations per thread, for the profiler and the microbenchmarks.
+ * It's linked into the binaries but not the library, so programs embedding the stitcher keep their own allocator.
+ * Counting costs a thread-local increment, which is negligible next to the allocation itself
+ */
+static thread_local int64_t num_allocations = 0;
+
+int64_t thread_allocations(){ return num_allocations; }
+
+void* operator new(size_t size){
+  num_allocations++;
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == NULL)
+    throw std::bad_alloc();
+  return ptr;
+}
+void* operator new[](size_t size){ return operator new(size); }
+void  operator delete(void* ptr) noexcept { free(ptr); }
+void  operator delete[](void* ptr) noexcept { free(ptr); }
+void  operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void  operator delete[](void* ptr, size_t) noexcept { free(ptr); }
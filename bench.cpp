@@ -0,0 +1,256 @@
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+#include <stdlib.h>
+
+#include "error.h"
+#include "read_simulator.h"
+#include "read_stitcher.h"
+#include "stringops.h"
+
+/*
+ * End-to-end throughput benchmark. Simulated read pairs are loaded into batches up front and then trimmed,
+ * filtered and stitched by stitch_pair() on each of the requested engines and thread counts. Stitched reads are
+ * checked against the read that merging the pair at its true offset produces
+ */
+
+const static size_t BENCH_BATCH_SIZE = 4096;
+
+class BenchResult {
+public:
+  double  seconds;
+  int64_t status[NUM_STITCH_STATUSES];
+  int64_t correct;
+};
+
+static StitchEngine parse_engine(const std::string& name){
+  if (name.compare("bitparallel") == 0)
+    return BITPARALLEL_ENGINE;
+  else if (name.compare("suffix-tree") == 0)
+    return SUFFIX_TREE_ENGINE;
+  else if (name.compare("suffix-array") == 0)
+    return SUFFIX_ARRAY_ENGINE;
+  printErrorAndDie("Engines must be one of bitparallel, suffix-tree or suffix-array");
+}
+
+static void load_batches(ReadSimulator& simulator, int64_t num_pairs, std::vector<ReadPairBatch>& batches, std::vector<SimulatedPair>& pairs){
+  pairs.resize(num_pairs);
+  batches.assign((num_pairs + BENCH_BATCH_SIZE - 1)/BENCH_BATCH_SIZE, ReadPairBatch());
+  for (int64_t i = 0; i < num_pairs; i++){
+    SimulatedPair& pair = pairs[i];
+    simulator.next_pair(pair);
+    ReadPairBatch& batch = batches[i/BENCH_BATCH_SIZE];
+    batch.index = i/BENCH_BATCH_SIZE;
+    batch.reads_1.add(pair.name.data(), pair.name.size(), pair.seq_1.data(), pair.qual_1.data(), pair.seq_1.size());
+    batch.reads_2.add(pair.name.data(), pair.name.size(), pair.seq_2.data(), pair.qual_2.data(), pair.seq_2.size());
+  }
+}
+
+/* Builds the read that merging the batch's i-th pair at its true offset produces, using the same base selection as ReadStitcher */
+static bool expected_merge(ReadPairBatch& batch, size_t i, const SimulatedPair& pair, std::string& merged){
+  bool reverse   = pair.read_2_upstream;
+  ReadBatch* up   = (reverse ? &batch.reads_2 : &batch.reads_1);
+  ReadBatch* down = (reverse ? &batch.reads_1 : &batch.reads_2);
+
+  // Trimming moves the starts of the reads, which can change which read comes first
+  int index = pair.offset + down->left_trimmed(i) - up->left_trimmed(i);
+  if (index < 0 || (index == 0 && reverse)){
+    std::swap(up, down);
+    index = -index;
+  }
+
+  StringView s1 = up->sequence(i),   q1 = up->quality(i);
+  StringView s2 = down->sequence(i), q2 = down->quality(i);
+  if (index >= s1.size)
+    return false;
+  merged.assign(s1.data, index);
+  int j;
+  for (j = 0; j < std::min(s1.size-index, s2.size); j++)
+    merged += (q1[index+j] >= q2[j] ? s1[index+j] : s2[j]);
+  if (index+j < s1.size)
+    merged.append(s1.data+index+j, s1.size-index-j);
+  else
+    merged.append(s2.data+j, s2.size-j);
+  return true;
+}
+
+static BenchResult run_benchmark(ReadSimulator simulator, int64_t num_pairs, int num_threads, int max_read_len, int max_k, int min_bp_overlap,
+				 double min_frac_correct, int seed_length, StitchEngine engine, LCAMethod lca_method){
+  std::vector<ReadPairBatch> batches;
+  std::vector<SimulatedPair> pairs;
+  load_batches(simulator, num_pairs, batches, pairs);
+
+  std::vector<ReadStitcher*> stitchers;
+  for (int i = 0; i < num_threads; i++)
+    stitchers.push_back(new ReadStitcher(max_read_len, max_k, min_bp_overlap, min_frac_correct, seed_length, engine, lca_method));
+
+  std::atomic<size_t> next_batch(0);
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_threads; i++){
+    ReadStitcher* stitcher = stitchers[i];
+    workers.push_back(std::thread([&, stitcher](){
+	  size_t index;
+	  while ((index = next_batch++) < batches.size()){
+	    ReadPairBatch& batch = batches[index];
+	    for (size_t j = 0; j < batch.size(); j++)
+	      batch.status.push_back(stitcher->stitch_pair(batch, j));
+	  }
+	}));
+  }
+  for (int i = 0; i < num_threads; i++)
+    workers[i].join();
+  auto end = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_threads; i++)
+    delete stitchers[i];
+
+  BenchResult result;
+  result.seconds = std::chrono::duration<double>(end - start).count();
+  std::fill(result.status, result.status+NUM_STITCH_STATUSES, 0);
+  result.correct = 0;
+  std::string expected;
+  for (size_t b = 0; b < batches.size(); b++){
+    ReadPairBatch& batch = batches[b];
+    size_t stitch_index = 0;
+    for (size_t j = 0; j < batch.size(); j++){
+      result.status[batch.status[j]]++;
+      if (batch.status[j] != STITCHED)
+	continue;
+      StringView stitched = batch.stitched.sequence(stitch_index++);
+      if (expected_merge(batch, j, pairs[b*BENCH_BATCH_SIZE + j], expected)
+	  && expected.size() == (size_t)stitched.size && expected.compare(0, expected.size(), stitched.data, stitched.size) == 0)
+	result.correct++;
+    }
+  }
+  return result;
+}
+
+static void print_usage(){
+  std::cout
+    << "Usage: ReadStitcherBench [options]"                                                                                        << "\n"
+    << "\t" << "--pairs            <INT>          " << "\t" << " Number of simulated pairs of reads (Default = 200000)"           << "\n"
+    << "\t" << "--read-length      <INT>          " << "\t" << " Length of each simulated read (Default = 150)"                    << "\n"
+    << "\t" << "--insert-mean      <FLOAT>        " << "\t" << " Mean fragment length (Default = 250)"                             << "\n"
+    << "\t" << "--insert-sd        <FLOAT>        " << "\t" << " Standard deviation of the fragment length (Default = 50)"        << "\n"
+    << "\t" << "--error-rate       <FLOAT>        " << "\t" << " Per-base substitution rate (Default = 0.01)"                      << "\n"
+    << "\t" << "--n-rate           <FLOAT>        " << "\t" << " Per-base rate of N calls (Default = 0.0002)"                      << "\n"
+    << "\t" << "--swap-rate        <FLOAT>        " << "\t" << " Fraction of pairs whose mates are swapped (Default = 0.5)"        << "\n"
+    << "\t" << "--random-seed      <INT>          " << "\t" << " Seed for the read simulator (Default = 1187238845)"               << "\n"
+    << "\t" << "--engines          <LIST>         " << "\t" << " Comma-separated overlap detection engines (Default = bitparallel,suffix-tree,suffix-array)" << "\n"
+    << "\t" << "--lca              <STRING>       " << "\t" << " LCA method for the suffix-tree engine (Default = sparse-table)"  << "\n"
+    << "\t" << "--threads          <LIST>         " << "\t" << " Comma-separated numbers of stitching threads (Default = 1)"       << "\n"
+    << "\t" << "--max-mismatches   <INT>          " << "\t" << " Maximum number of overlapping bases that can not match (Default = 10)" << "\n"
+    << "\t" << "--min-overlap      <INT>          " << "\t" << " Minimum number of overlapping bases required (Default = 10)"     << "\n"
+    << "\t" << "--min-frac-correct <FLOAT>        " << "\t" << " Minimum fraction of overlapping bases that must match (Default = 0.9)" << "\n"
+    << "\t" << "--seed-length      <INT>          " << "\t" << " Length of the exact seeds used to rule out offsets (Default = 8)" << "\n" << std::endl;
+  exit(0);
+}
+
+int main(int argc, char** argv){
+  int64_t num_pairs       = 200000;
+  int    read_length      = 150;
+  double insert_mean      = 250;
+  double insert_sd        = 50;
+  double error_rate       = 0.01;
+  double n_rate           = 0.0002;
+  double swap_rate        = 0.5;
+  uint32_t random_seed    = 1187238845;
+  std::string engines     = "bitparallel,suffix-tree,suffix-array";
+  std::string lca_name    = "sparse-table";
+  std::string threads     = "1";
+  int    max_k            = 10;
+  int    min_bp_overlap   = 10;
+  double min_frac_correct = 0.9;
+  int    seed_length      = 8;
+  int    print_help       = 0;
+
+  static struct option long_options[] = {
+    {"pairs",            required_argument, 0, 'n'},
+    {"read-length",      required_argument, 0, 'l'},
+    {"insert-mean",      required_argument, 0, 'I'},
+    {"insert-sd",        required_argument, 0, 'S'},
+    {"error-rate",       required_argument, 0, 'E'},
+    {"n-rate",           required_argument, 0, 'N'},
+    {"swap-rate",        required_argument, 0, 'w'},
+    {"random-seed",      required_argument, 0, 'r'},
+    {"engines",          required_argument, 0, 'e'},
+    {"lca",              required_argument, 0, 'c'},
+    {"threads",          required_argument, 0, 't'},
+    {"max-mismatches",   required_argument, 0, 'm'},
+    {"min-overlap",      required_argument, 0, 'o'},
+    {"min-frac-correct", required_argument, 0, 'f'},
+    {"seed-length",      required_argument, 0, 's'},
+    {"help",        no_argument, &print_help, 1},
+    {0, 0, 0, 0}
+  };
+
+  int c;
+  while ((c = getopt_long(argc, argv, "c:e:f:l:m:n:o:r:s:t:w:E:I:N:S:", long_options, NULL)) != -1){
+    switch (c){
+    case 0:   break;
+    case 'c': lca_name         = optarg;        break;
+    case 'e': engines          = optarg;        break;
+    case 'f': min_frac_correct = atof(optarg);  break;
+    case 'l': read_length      = atoi(optarg);  break;
+    case 'm': max_k            = atoi(optarg);  break;
+    case 'n': num_pairs        = atoll(optarg); break;
+    case 'o': min_bp_overlap   = atoi(optarg);  break;
+    case 'r': random_seed      = strtoul(optarg, NULL, 10); break;
+    case 's': seed_length      = atoi(optarg);  break;
+    case 't': threads          = optarg;        break;
+    case 'w': swap_rate        = atof(optarg);  break;
+    case 'E': error_rate       = atof(optarg);  break;
+    case 'I': insert_mean      = atof(optarg);  break;
+    case 'N': n_rate           = atof(optarg);  break;
+    case 'S': insert_sd        = atof(optarg);  break;
+    default:
+      printErrorAndDie("Unrecognized command line option");
+    }
+  }
+  if (print_help == 1)
+    print_usage();
+  if (num_pairs < 1 || read_length < 1)
+    printErrorAndDie("--pairs and --read-length must be at least 1");
+  if (seed_length < 0 || seed_length > 16)
+    printErrorAndDie("--seed-length must be between 0 and 16");
+
+  LCAMethod lca_method;
+  if (lca_name.compare("schieber-vishkin") == 0)
+    lca_method = SCHIEBER_VISHKIN_LCA;
+  else if (lca_name.compare("sparse-table") == 0)
+    lca_method = SPARSE_TABLE_LCA;
+  else
+    printErrorAndDie("Argument to --lca must be either schieber-vishkin or sparse-table");
+
+  std::vector<std::string> engine_names = split_string(engines, ',');
+  std::vector<std::string> thread_counts = split_string(threads, ',');
+  ReadSimulator simulator(random_seed, read_length, insert_mean, insert_sd, error_rate, n_rate, swap_rate);
+
+  std::cout << "engine\tthreads\tpairs\tseconds\tpairs/sec\tns/pair\tstitch_rate\taccuracy\tn_skipped\ttrim_failed" << std::endl;
+  for (size_t e = 0; e < engine_names.size(); e++){
+    StitchEngine engine = parse_engine(engine_names[e]);
+    for (size_t t = 0; t < thread_counts.size(); t++){
+      int num_threads = atoi(thread_counts[t].c_str());
+      if (num_threads < 1)
+	printErrorAndDie("Thread counts must be at least 1");
+
+      // Every run stitches the same pairs, as the simulator is copied rather than advanced
+      BenchResult result = run_benchmark(simulator, num_pairs, num_threads, read_length, max_k, min_bp_overlap,
+					 min_frac_correct, seed_length, engine, lca_method);
+      int64_t stitched = result.status[STITCHED];
+      std::cout << engine_names[e] << "\t" << num_threads << "\t" << num_pairs << "\t"
+		<< std::fixed << std::setprecision(3) << result.seconds << "\t"
+		<< std::setprecision(0) << num_pairs/result.seconds << "\t"
+		<< std::setprecision(1) << 1e9*result.seconds/num_pairs << "\t"
+		<< std::setprecision(4) << 1.0*stitched/num_pairs << "\t"
+		<< (stitched == 0 ? 0.0 : 1.0*result.correct/stitched) << "\t"
+		<< result.status[N_SKIPPED] << "\t" << result.status[TRIM_FAILED] << std::endl;
+    }
+  }
+  return 0;
+}
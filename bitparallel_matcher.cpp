@@ -0,0 +1,211 @@
+#include <algorithm>
+
+#include "bitparallel_matcher.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITPARALLEL_X86
+#endif
+
+const uint64_t LOW_BITS = 0x5555555555555555ULL;
+
+/* Returns the 32 bases starting at base_offset. Requires one word of padding after the last base */
+static inline uint64_t packed_word(const uint64_t* words, int base_offset){
+  int q = base_offset >> 5;
+  int r = (base_offset & 31) << 1;
+  return (r == 0 ? words[q] : (words[q] >> r) | (words[q+1] << (64-r)));
+}
+
+/* Returns the 2-bit code of the base at pos */
+static inline uint64_t base_at(const uint64_t* words, int pos){
+  return (words[pos >> 5] >> ((pos & 31) << 1)) & 3;
+}
+
+/* Reduces the XOR of two packed words to one bit per mismatched base */
+static inline uint64_t mismatch_bits(uint64_t x){
+  return (x | (x >> 1)) & LOW_BITS;
+}
+
+/* Mask selecting the first num_bases bases of a packed word */
+static inline uint64_t base_mask(int num_bases){
+  return (num_bases == 32 ? ~0ULL : (1ULL << (2*num_bases)) - 1);
+}
+
+/*
+ * Counts the mismatches between s1[offset, offset+length) and s2[0, length), stopping
+ * early once the count exceeds max_count. Inlined into each of the target-specific kernels below
+ */
+static inline __attribute__((always_inline)) int count_mismatches_words(const uint64_t* s1_words, int offset, const uint64_t* s2_words, int length, int max_count, int count){
+  int num_full = length >> 5;
+  for (int i = 0; i < num_full; i++){
+    count += __builtin_popcountll(mismatch_bits(packed_word(s1_words, offset + 32*i) ^ s2_words[i]));
+    if (count > max_count)
+      return count;
+  }
+  int tail = length & 31;
+  if (tail != 0)
+    count += __builtin_popcountll(mismatch_bits(packed_word(s1_words, offset + 32*num_full) ^ s2_words[num_full]) & base_mask(tail));
+  return count;
+}
+
+static int count_mismatches_generic(const uint64_t* s1_words, int offset, const uint64_t* s2_words, int length, int max_count){
+  return count_mismatches_words(s1_words, offset, s2_words, length, max_count, 0);
+}
+
+#ifdef BITPARALLEL_X86
+__attribute__((target("popcnt")))
+static int count_mismatches_popcnt(const uint64_t* s1_words, int offset, const uint64_t* s2_words, int length, int max_count){
+  return count_mismatches_words(s1_words, offset, s2_words, length, max_count, 0);
+}
+
+/*
+ * Processes 4 words (128 bases) per iteration. The shifted s1 words are assembled with 256-bit shifts
+ * and the per-byte mismatch counts are obtained with the nibble lookup (vpshufb) popcount
+ */
+__attribute__((target("avx2,popcnt")))
+static int count_mismatches_avx2(const uint64_t* s1_words, int offset, const uint64_t* s2_words, int length, int max_count){
+  const __m256i lookup    = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+					     0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+  const __m256i low_bits   = _mm256_set1_epi64x((long long)LOW_BITS);
+  const __m128i rshift     = _mm_cvtsi32_si128((offset & 31) << 1);
+  const __m128i lshift     = _mm_cvtsi32_si128(64 - ((offset & 31) << 1));
+  const uint64_t* s1       = s1_words + (offset >> 5);
+
+  int count = 0, i = 0;
+  for (; i + 4 <= (length >> 5); i += 4){
+    __m256i lo = _mm256_loadu_si256((const __m256i*)(s1 + i));
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(s1 + i + 1));
+    // A left shift by 64 yields 0, so aligned offsets need no special case
+    __m256i a  = _mm256_or_si256(_mm256_srl_epi64(lo, rshift), _mm256_sll_epi64(hi, lshift));
+    __m256i x  = _mm256_xor_si256(a, _mm256_loadu_si256((const __m256i*)(s2_words + i)));
+    __m256i m  = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 1)), low_bits);
+    __m256i c  = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(m, low_nibble)),
+				 _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(m, 4), low_nibble)));
+    __m256i s  = _mm256_sad_epu8(c, _mm256_setzero_si256());
+    count += _mm256_extract_epi64(s, 0) + _mm256_extract_epi64(s, 1) + _mm256_extract_epi64(s, 2) + _mm256_extract_epi64(s, 3);
+    if (count > max_count)
+      return count;
+  }
+  return count_mismatches_words(s1_words, offset + 32*i, s2_words + i, length - 32*i, max_count, count);
+}
+#endif
+
+BaseCodes::BaseCodes(){
+  std::fill(code, code+256, 0);
+  code['C'] = 1;
+  code['G'] = 2;
+  code['T'] = 3;
+}
+
+const BaseCodes BASE_CODES;
+
+BitParallelMatcher::BitParallelMatcher(){
+  count_mismatches = count_mismatches_generic;
+#ifdef BITPARALLEL_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+    count_mismatches = count_mismatches_avx2;
+  else if (__builtin_cpu_supports("popcnt"))
+    count_mismatches = count_mismatches_popcnt;
+#endif
+}
+
+const char* BitParallelMatcher::kernel_name(){
+#ifdef BITPARALLEL_X86
+  if (count_mismatches == count_mismatches_avx2)
+    return "avx2";
+  if (count_mismatches == count_mismatches_popcnt)
+    return "popcnt";
+#endif
+  return "generic";
+}
+
+void BitParallelMatcher::pack(const StringView& s, std::vector<uint64_t>& words){
+  // One word of padding so that packed_word() can always read the following word
+  words.assign(s.size/32 + 2, 0);
+  for (int i = 0; i < s.size; i++)
+    words[i >> 5] |= ((uint64_t)base_code(s[i])) << ((i & 31) << 1);
+}
+
+void BitParallelMatcher::prepare(const StringView& s1, const StringView& s2){
+  pack(s1, s1_words);
+  pack(s2, s2_words);
+  len_1 = s1.size;
+  len_2 = s2.size;
+}
+
+void BitParallelMatcher::kMismatch(bool reverse, int max_k, int min_bp_overlap, double min_frac_correct, const char* candidates, SearchStats& stats,
+				   int* best_frac_idx, double* best_frac, int& num_bp_overlap, int& num_mismatches){
+  const uint64_t* first  = (reverse ? s2_words.data() : s1_words.data());
+  const uint64_t* second = (reverse ? s1_words.data() : s2_words.data());
+  int len_first  = (reverse ? len_2 : len_1);
+  int len_second = (reverse ? len_1 : len_2);
+
+  *best_frac      = 0;
+  *best_frac_idx  = -1;
+  num_bp_overlap  = -1;
+  num_mismatches  = -1;
+
+  int num_offsets = std::max(0, len_first - min_bp_overlap);
+  stats.offsets += num_offsets;
+  for (int i = 0; i < num_offsets; i++){
+    if (candidates != NULL && !candidates[i]){
+      stats.offsets_filtered++;
+      continue;
+    }
+
+    // Most mismatches an offset can contain and still exceed both min_frac_correct and the best result so far
+    double threshold = std::max(*best_frac, min_frac_correct);
+    int overlap, mismatches;
+    if (len_first - i <= len_second){
+      // The first read ends within the second. The suffix tree walk tolerates max_k mismatches only if the last one is on the final base
+      overlap   = len_first - i;
+      int limit = std::min(max_k, max_mismatches_above(overlap, threshold));
+      if (limit < 0){
+	stats.offsets_skipped += num_offsets - i;
+	return;
+      }
+      mismatches = count_mismatches(first, i, second, overlap, limit);
+      if (mismatches > limit){
+	if (limit < max_k)
+	  stats.walks_aborted++;
+	continue;
+      }
+      if (mismatches == max_k && base_at(first, len_first-1) == base_at(second, overlap-1))
+	continue;
+    }
+    else {
+      // The second read ends within the first. The suffix tree walk counts its end as an additional overlapping mismatch
+      int limit = (len_second >= min_bp_overlap ? std::min(max_k-1, max_mismatches_above(len_second+1, threshold)-1) : -1);
+      if (limit < 0){
+	// The bound is the same for every offset at which the second read ends within the first
+	int next = std::min(len_first - len_second, num_offsets);
+	stats.offsets_skipped += next - i;
+	i = next - 1;
+	continue;
+      }
+      mismatches = count_mismatches(first, i, second, len_second, limit);
+      if (mismatches > limit){
+	if (limit < max_k-1)
+	  stats.walks_aborted++;
+	continue;
+      }
+      overlap     = len_second + 1;
+      mismatches += 1;
+    }
+
+    // Check if stitching satisfies minimum fraction requirement
+    double frac = 1.0*(overlap-mismatches)/overlap;
+    if (frac > min_frac_correct && frac > *best_frac){
+      *best_frac     = frac;
+      *best_frac_idx = i;
+      num_bp_overlap = overlap;
+      num_mismatches = mismatches;
+
+      // Perfect matches are maximal as we scan from left to right, so we can abort the search
+      if (mismatches == 0)
+	return;
+    }
+  }
+}
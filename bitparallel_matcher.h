@@ -0,0 +1,71 @@
+#ifndef BITPARALLEL_MATCHER_H
+#define BITPARALLEL_MATCHER_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "search_stats.h"
+#include "string_view.h"
+
+/*
+ * 2-bit codes of the bases packed by BitParallelMatcher and seeded by SeedFilter: A = 0, C = 1, G = 2 and T = 3.
+ * Every other character, N included, encodes as A. That's only safe because stitch_pair() skips pairs containing N
+ * before their reads are filtered or scored, and AdapterInference skips them as well
+ */
+class BaseCodes {
+ public:
+  uint8_t code[256];
+
+  BaseCodes();
+};
+
+extern const BaseCodes BASE_CODES;
+
+inline uint32_t base_code(char base){ return BASE_CODES.code[(unsigned char)base]; }
+
+/*
+ * Overlap detection that compares the reads directly at every offset instead of building a suffix tree.
+ * Both reads are packed into 64-bit words holding 32 2-bit bases, and the mismatches at an offset are
+ * counted 32 bases at a time using XOR + popcount. The popcount kernel (generic, POPCNT or AVX2) is
+ * selected at runtime based on the CPU's capabilities.
+ *
+ * kMismatch() reports exactly the same results as the suffix tree based ReadStitcher::kMismatch, including
+ * its conventions for reads that overhang one another. A pair is packed once by prepare() and can then be
+ * scored in both orientations
+ */
+class BitParallelMatcher {
+ public:
+  typedef int (*MismatchKernel)(const uint64_t* s1_words, int offset, const uint64_t* s2_words, int length, int max_count);
+
+ private:
+  MismatchKernel count_mismatches;
+  std::vector<uint64_t> s1_words, s2_words;
+  int len_1, len_2;
+
+ public:
+  BitParallelMatcher();
+
+  /* Packs s 32 bases per word, followed by the padding that the kernels expect */
+  void pack(const StringView& s, std::vector<uint64_t>& words);
+
+  /* Mismatches between s1[offset, offset+length) and s2[0, length) of packed sequences. Stops counting once it exceeds max_count */
+  int mismatches(const uint64_t* s1_words, int offset, const uint64_t* s2_words, int length, int max_count){
+    return count_mismatches(s1_words, offset, s2_words, length, max_count);
+  }
+
+  /* Name of the popcount kernel that was selected for this CPU */
+  const char* kernel_name();
+
+  void prepare(const StringView& s1, const StringView& s2);
+
+  /*
+   * Scores the prepared pair. If reverse is true, s2 is assumed to be upstream of s1. If candidates is not NULL,
+   * only the offsets it flags are verified. Filtered and pruned offsets are tallied in stats
+   */
+  void kMismatch(bool reverse, int max_k, int min_bp_overlap, double min_frac_correct, const char* candidates, SearchStats& stats,
+		 int* best_frac_idx, double* best_frac, int& num_bp_overlap, int& num_mismatches);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include <fstream>
+#include <sstream>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "error.h"
+
+void Checkpoint::write(const std::string& path){
+  std::stringstream tmp_path;
+  tmp_path << path << ".tmp" << getpid();
+  std::ofstream output(tmp_path.str().c_str());
+  if (!output.is_open())
+    printErrorAndDie("Failed to open checkpoint file " + tmp_path.str());
+
+  output << "settings\t"   << settings << "\n"
+	 << "f1\t"         << f1_position.offset << "\t" << f1_position.skip << "\n"
+	 << "f2\t"         << f2_position.offset << "\t" << f2_position.skip << "\n"
+	 << "pairs_left\t" << pairs_left << "\n"
+	 << "adapter_1\t"  << adapters[0] << "\n"
+	 << "adapter_2\t"  << adapters[1] << "\n";
+  for (size_t i = 0; i < outputs.size(); i++)
+    output << "output\t" << outputs[i] << "\t" << output_sizes[i] << "\n";
+  output << "stats" << "\n";
+  stats.write_tsv(output, search_stats);
+  output.close();
+
+  if (output.fail() || rename(tmp_path.str().c_str(), path.c_str()) != 0)
+    printErrorAndDie("Failed to write checkpoint file " + path);
+}
+
+bool Checkpoint::read(const std::string& path){
+  std::ifstream input(path.c_str());
+  if (!input.is_open())
+    return false;
+
+  outputs.clear();
+  output_sizes.clear();
+  std::string line, key;
+  bool has_stats = false;
+  while (!has_stats && std::getline(input, line)){
+    std::istringstream fields(line);
+    std::getline(fields, key, '\t');
+    bool valid = true;
+    if (key.compare("settings") == 0)
+      std::getline(fields, settings);
+    else if (key.compare("f1") == 0)
+      valid = !(fields >> f1_position.offset >> f1_position.skip).fail();
+    else if (key.compare("f2") == 0)
+      valid = !(fields >> f2_position.offset >> f2_position.skip).fail();
+    else if (key.compare("pairs_left") == 0)
+      valid = !(fields >> pairs_left).fail();
+    else if (key.compare("adapter_1") == 0)
+      std::getline(fields, adapters[0]);
+    else if (key.compare("adapter_2") == 0)
+      std::getline(fields, adapters[1]);
+    else if (key.compare("output") == 0){
+      std::string output;
+      int64_t size;
+      valid = (std::getline(fields, output, '\t') && fields >> size);
+      outputs.push_back(output);
+      output_sizes.push_back(size);
+    }
+    else if (key.compare("stats") == 0)
+      has_stats = true;
+    else
+      valid = false;
+    if (!valid)
+      printErrorAndDie("Malformed line in checkpoint file " + path + ": " + line);
+  }
+  if (!has_stats || !stats.read_tsv(input, search_stats))
+    printErrorAndDie("Malformed statistics in checkpoint file " + path);
+  return true;
+}
@@ -0,0 +1,40 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "fastq_reader.h"
+#include "search_stats.h"
+#include "stitch_stats.h"
+
+/*
+ * State of stitch_fastq() after the last pair of a written batch: where each reader continues, how large each output
+ * was once its records had been flushed, and the statistics of every pair up to that point. Resuming truncates the
+ * outputs to those sizes, seeks the readers and restores the statistics, so the finished outputs, log and statistics
+ * are the same as those of an uninterrupted run
+ */
+class Checkpoint {
+public:
+  std::string settings;               // Inputs, shard, compression level and options that determine the outputs, which must match to resume
+  ReaderPosition f1_position;
+  ReaderPosition f2_position;
+  int64_t pairs_left;                 // Pairs the shard still has to read, or -1 if it reads to the end of the input
+  std::string adapters[2];            // Adapters in use, including any that were inferred
+  std::vector<std::string> outputs;
+  std::vector<int64_t> output_sizes;
+  StitchStats stats;
+  SearchStats search_stats;
+
+  Checkpoint(){ pairs_left = -1; }
+
+  /* Replaces path, going through a temporary file so an interruption leaves the previous checkpoint intact */
+  void write(const std::string& path);
+
+  /* Returns false if path doesn't exist */
+  bool read(const std::string& path);
+};
+
+#endif
@@ -1,65 +1,293 @@
 #include <algorithm>
 #include <iostream>
 
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "error.h"
 #include "fastq_reader.h"
 #include "stringops.h"
 
-FASTQReader::FASTQReader(std::string filename, bool paired_end, bool reverse_complement){
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FASTQ_READER_X86
+#endif
+
+/* Stores the offsets of up to count newlines in data[0, length) in newlines and returns how many were found */
+static size_t find_newlines_generic(const char* data, size_t length, size_t* newlines, size_t count){
+  size_t found = 0, scan = 0;
+  while (found < count){
+    const char* newline = (const char*)memchr(data + scan, '\n', length - scan);
+    if (newline == NULL)
+      break;
+    newlines[found++] = newline - data;
+    scan = newline - data + 1;
+  }
+  return found;
+}
+
+#ifdef FASTQ_READER_X86
+/* Compares 32 bytes per instruction, so a record's four short lines typically take a handful of loads */
+__attribute__((target("avx2")))
+static size_t find_newlines_avx2(const char* data, size_t length, size_t* newlines, size_t count){
+  const __m256i newline = _mm256_set1_epi8('\n');
+  size_t found = 0, i = 0;
+  for (; i + 32 <= length; i += 32){
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i)), newline));
+    while (mask != 0){
+      newlines[found++] = i + __builtin_ctz(mask);
+      if (found == count)
+	return found;
+      mask &= mask - 1;
+    }
+  }
+  // The last partial block
+  size_t tail = find_newlines_generic(data + i, length - i, newlines + found, count - found);
+  for (size_t j = found; j < found + tail; j++)
+    newlines[j] += i;
+  return found + tail;
+}
+#endif
+
+static size_t (*find_newlines)(const char* data, size_t length, size_t* newlines, size_t count) = find_newlines_generic;
+
+FASTQReader::FASTQReader(std::string filename, bool paired_end){
   this->filename   = filename;
   this->paired_end = paired_end;
-  this->rev_complement = reverse_complement;
-  input.open(filename.c_str());
-  std::getline(input, next_line);
+  input   = NULL;
+  data_   = NULL;
+  mapped_ = false;
+  pos_ = end_ = 0;
+  eof_ = false;
+  buffer_start_ = 0;
+  profile_ = NULL;
+
+#ifdef FASTQ_READER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    find_newlines = find_newlines_avx2;
+#endif
+
+  if (!map_file()){
+    input = bgzf_open(filename.c_str(), "r");
+    if (input == NULL)
+      printErrorAndDie("Failed to open FASTQ file " + filename);
+    buffer_.resize(CHUNK_SIZE);
+    data_ = buffer_.data();
+  }
+}
+
+bool FASTQReader::map_file(){
+  if (filename.compare("-") == 0)
+    return false;
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  // Anything that starts like gzip, including BGZF, is left to htslib
+  struct stat info;
+  unsigned char magic[2];
+  bool uncompressed = (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)
+		       && (pread(fd, magic, 2, 0) < 2 || magic[0] != 0x1f || magic[1] != 0x8b));
+  if (uncompressed && info.st_size > 0){
+    void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+      uncompressed = false;
+    else {
+      madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+      data_ = (char*)mapping;
+      end_  = info.st_size;
+    }
+  }
+  ::close(fd);
+  mapped_ = uncompressed;
+  return mapped_;
 }
 
 FASTQReader::~FASTQReader(){ close(); }
 
-bool FASTQReader::is_empty(){ return !input; }
+void FASTQReader::set_io_threads(int num_threads){
+  if (num_threads > 0 && input != NULL && bgzf_mt(input, num_threads, 256) != 0)
+    printErrorAndDie("Failed to enable multithreaded decompression for FASTQ file " + filename);
+}
 
-ReadInfo FASTQReader::next_read(){
-  std::string identifier, sequence, quality;
-  identifier = next_line;
-  size_t space = identifier.find(" ");
-  if (space != std::string::npos)
-    identifier = identifier.substr(0, space);
+bool FASTQReader::fill(){
+  if (eof_ || input == NULL)
+    return false;
 
-  if (!input)
-    printErrorAndDie("Attempt to read line in FASTQ_READER when stream is empty");
-  std::getline(input, sequence);
+  size_t remaining = end_ - pos_;
+  if (pos_ != 0){
+    memmove(buffer_.data(), buffer_.data() + pos_, remaining);
+    buffer_start_ += pos_;
+    pos_ = 0;
+    end_ = remaining;
+  }
+  // Only the last mark at or before the buffer's first byte is still needed
+  size_t obsolete = 0;
+  while (obsolete+1 < marks_.size() && marks_[obsolete+1].second <= buffer_start_)
+    obsolete++;
+  marks_.erase(marks_.begin(), marks_.begin() + obsolete);
+  // Grows the buffer for records that are larger than the unused space
+  if (buffer_.size() - end_ < CHUNK_SIZE/2)
+    buffer_.resize(end_ + CHUNK_SIZE);
+  data_ = buffer_.data();
 
-  if (!input)
-    printErrorAndDie("Attempt to read line in FASTQ_READER when stream is empty");
-  std::getline(input, quality);
+  ssize_t num_read;
+  {
+    ProfileScope scope(profile_, STAGE_DECOMPRESS);
+    marks_.push_back(std::pair<int64_t, int64_t>(bgzf_tell(input), buffer_start_ + end_));
+    num_read = bgzf_read(input, buffer_.data() + end_, buffer_.size() - end_);
+  }
+  if (num_read < 0)
+    printErrorAndDie("Failed to decompress data from FASTQ file " + filename);
+  if (num_read == 0){
+    eof_ = true;
+    return false;
+  }
+  end_ += num_read;
+  return true;
+}
+
+void FASTQReader::seek(int64_t virtual_offset){
+  if (mapped_){
+    size_t offset = (virtual_offset >> 16) + (virtual_offset & 0xFFFF);
+    if (virtual_offset < 0 || offset > end_)
+      printErrorAndDie("Failed to seek in FASTQ file " + filename);
+    pos_ = offset;
+    return;
+  }
+  if (bgzf_seek(input, virtual_offset, SEEK_SET) < 0)
+    printErrorAndDie("Failed to seek in FASTQ file " + filename);
+  pos_ = end_ = 0;
+  eof_ = false;
+  buffer_start_ = 0;
+  marks_.clear();
+}
 
-  if (!input)
-    printErrorAndDie("Attempt to read line in FASTQ_READER when stream is empty");
-  std::getline(input, quality);  
+ReaderPosition FASTQReader::position(){
+  ReaderPosition position;
+  if (mapped_){
+    position.offset = (int64_t)pos_ << 16;
+    return position;
+  }
+  if (marks_.empty()){
+    position.offset = bgzf_tell(input);
+    return position;
+  }
+  int64_t next = buffer_start_ + pos_;
+  size_t i = marks_.size()-1;
+  while (marks_[i].second > next)
+    i--;
+  position.offset = marks_[i].first;
+  position.skip   = next - marks_[i].second;
+  return position;
+}
+
+void FASTQReader::seek(const ReaderPosition& position){
+  seek(position.offset);
+  size_t start = pos_;
+  while (end_ < start + position.skip && fill());
+  if (end_ < start + position.skip)
+    printErrorAndDie("FASTQ file " + filename + " ends before the position to resume from");
+  pos_ = start + position.skip;
+}
+
+bool FASTQReader::is_empty(){
+  return (pos_ == end_ && !fill());
+}
+
+void FASTQReader::next_record(FASTQRecord& record, bool rev_complement){
+  ProfileScope scope(profile_, STAGE_PARSE);
+  // Locate the ends of the record's four lines. Positions are relative to pos_, as refilling moves the data
+  size_t line_ends[4];
+  size_t num_lines = 0, scan = 0;
+  while (true){
+    size_t found = find_newlines(data_ + pos_ + scan, end_ - pos_ - scan, line_ends + num_lines, 4 - num_lines);
+    for (size_t i = num_lines; i < num_lines + found; i++)
+      line_ends[i] += scan;
+    num_lines += found;
+    if (num_lines == 4)
+      break;
+    scan = end_ - pos_;
+    if (!fill()){
+      // Only the last line of the file can lack a trailing newline
+      size_t line_start = (num_lines == 0 ? 0 : line_ends[num_lines-1]+1);
+      if (num_lines != 3 || scan == line_start)
+	printErrorAndDie("Attempt to read line in FASTQ_READER when stream is empty");
+      line_ends[3] = scan;
+      break;
+    }
+  }
+
+  char* data = data_ + pos_;
+  pos_      += std::min(line_ends[3]+1, end_ - pos_);
+
+  char* identifier  = data;
+  size_t id_len     = line_ends[0];
+  char* space       = (char*)memchr(identifier, ' ', id_len);
+  if (space != NULL)
+    id_len = space - identifier;
+  if (id_len == 0 || identifier[0] != '@')
+    printErrorAndDie("Read identifier is FASTQ file must begin with @ character");
 
- if (identifier.at(0) != '@')
-   printErrorAndDie("Read identifier is FASTQ file must begin with @ character");
-	
   if (paired_end){
-    if (identifier.length() > 2 && identifier[identifier.length()-2] == '/') {
-      if (identifier.back() == '1' || identifier.back() == '2'){
-	identifier.pop_back();
-	identifier.pop_back();
-      }
+    if (id_len > 2 && identifier[id_len-2] == '/') {
+      if (identifier[id_len-1] == '1' || identifier[id_len-1] == '2')
+	id_len -= 2;
       else
 	printErrorAndDie("Read identifiers for paired-end files must end in /1 or /2");
     }
   }
 
+  record.identifier     = identifier + 1;
+  record.identifier_len = id_len - 1;
+  record.sequence       = data + line_ends[0] + 1;
+  record.sequence_len   = line_ends[1] - line_ends[0] - 1;
+  record.quality        = data + line_ends[2] + 1;
+  record.quality_len    = line_ends[3] - line_ends[2] - 1;
+
   if (rev_complement){
+    if (mapped_)
+      printErrorAndDie("Records of memory-mapped FASTQ file " + filename + " can't be reverse complemented in place");
     // Reverse complement the sequence and reverse the quality scores
-    reverse_complement(sequence);
-    std::reverse(quality.begin(), quality.end());
+    reverse_complement(record.sequence, record.sequence_len);
+    std::reverse(record.quality, record.quality + record.quality_len);
   }
+}
 
-  std::getline(input, next_line);
-  return ReadInfo(identifier.substr(1), sequence, quality, rev_complement);
+void FASTQReader::next_read(ReadBatch& batch, bool rev_complement){
+  FASTQRecord record;
+  next_record(record, false);
+  if (record.sequence_len != record.quality_len)
+    printErrorAndDie("Sequence and quality strings in FASTQ file " + filename + " have different lengths");
+  batch.set_reverse_complement(rev_complement);
+  if (!rev_complement){
+    batch.add(record.identifier, record.identifier_len, record.sequence, record.quality, record.sequence_len);
+    return;
+  }
+
+  // Reverse complemented in the batch rather than in place, so a memory-mapped input is only ever read
+  size_t i = batch.add(record.identifier, record.identifier_len, NULL, NULL, record.sequence_len);
+  ProfileScope scope(profile_, STAGE_PARSE);
+  reverse_complement(record.sequence, record.sequence_len, batch.mutable_sequence(i));
+  std::reverse_copy(record.quality, record.quality + record.quality_len, batch.mutable_quality(i));
 }
 
 void FASTQReader::close(){
-  input.close();
+  if (mapped_){
+    if (data_ != NULL)
+      munmap(data_, end_);
+    data_   = NULL;
+    mapped_ = false;
+    pos_ = end_ = 0;
+    return;
+  }
+  if (input == NULL)
+    return;
+  if (bgzf_close(input) != 0)
+    printErrorAndDie("Failed to close FASTQ file " + filename);
+  input = NULL;
 }
@@ -1,26 +1,96 @@
 #ifndef FASTQ_READER_H
 #define FASTQ_READER_H
 
-#include <fstream>
 #include <string>
+#include <vector>
 
-#include "read_info.h"
-#include "bgzf_streams.h"
+#include "profiler.h"
+#include "read_batch.h"
+#include "htslib/htslib/bgzf.h"
 
+// Fields of a FASTQ record, pointing into the reader's buffer. Only valid until the reader's next call
+class FASTQRecord {
+public:
+  char*  identifier;      // Excludes the leading @, anything after the first space and any /1 or /2 suffix
+  size_t identifier_len;
+  char*  sequence;
+  size_t sequence_len;
+  char*  quality;
+  size_t quality_len;
+};
+
+// Location of a record that seek() can return to: a virtual offset at or before it, and the bytes to skip from there
+class ReaderPosition {
+public:
+  int64_t offset;
+  int64_t skip;
+
+  ReaderPosition(){ offset = skip = 0; }
+};
+
+/*
+ * Reads records from a bgzipped, gzipped or uncompressed FASTQ file, or from stdin if the path is "-".
+ * Decompressed data is pulled into a large buffer with bgzf_read() and records are handed out as views into the
+ * buffer. Unparsed data is moved to the front of the buffer before each refill, so records can span any number of
+ * BGZF blocks. Uncompressed regular files are instead memory-mapped and parsed in place, skipping htslib's copies.
+ * Newlines are located 32 bytes at a time with AVX2 where the CPU supports it
+ */
 class FASTQReader {
 private:
   std::string filename;
-  bgzfistream input;
+  BGZF* input;
   bool paired_end;
-  bool rev_complement;
-  std::string next_line;
+  std::vector<char> buffer_;
+  char* data_;            // Data being parsed: buffer_, or the whole file if it's memory-mapped
+  bool mapped_;           // Whether data_ is a memory-mapped uncompressed file, in which case input is NULL
+  size_t pos_;            // Start of the unparsed data in data_
+  size_t end_;            // End of the valid data in data_
+  bool eof_;
+  int64_t buffer_start_;   // Bytes decompressed since the last seek before buffer_[0]
+  // Virtual offset before each bgzf_read() that may have produced buffered data, with the decompressed byte it refers to
+  std::vector<std::pair<int64_t, int64_t> > marks_;
+  StageProfile* profile_;  // Charged for decompression and parsing if not NULL
+
+  const static size_t CHUNK_SIZE = 1 << 20;
+
+  /* Maps the file if it's an uncompressed regular file. Returns false if it has to be read through BGZF */
+  bool map_file();
+
+  /* Appends more decompressed data to the buffer, moving the unparsed data to its front. Returns false at the end of the file */
+  bool fill();
 
 public:
-  FASTQReader(std::string file, bool paired_end, bool reverse_complement);
+  FASTQReader(std::string file, bool paired_end);
   ~FASTQReader();
 
+  /*
+   * Decompresses the input on a pool of num_threads htslib threads, which read ahead of the parser.
+   * Must be called before any records are read. 0 decompresses on the calling thread
+   */
+  void set_io_threads(int num_threads);
+
+  void set_profile(StageProfile* profile){ profile_ = profile; }
+
+  /*
+   * Continues reading from a virtual offset returned by bgzf_tell(), such as those in a ShardIndex. For memory-mapped
+   * files, the offset is converted to a file offset the way htslib does for uncompressed files
+   */
+  void seek(int64_t virtual_offset);
+
+  /* Position of the next record. Only virtual offsets and decompressed byte counts are used, so it's cheap */
+  ReaderPosition position();
+  void seek(const ReaderPosition& position);
+
   bool is_empty();
-  ReadInfo next_read();
+
+  /*
+   * Parses the next record, reverse complementing it in place if requested. Memory-mapped files are read-only, so their
+   * records can only be reverse complemented by next_read(), which does so while copying them
+   */
+  void next_record(FASTQRecord& record, bool reverse_complement);
+
+  /* Parses the next record and appends it to batch. Batches shouldn't mix reverse complemented and unmodified reads */
+  void next_read(ReadBatch& batch, bool reverse_complement);
   void close();
 };
 
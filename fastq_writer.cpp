@@ -1,30 +1,77 @@
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include "error.h"
 #include "fastq_writer.h"
 #include "stringops.h"
+#include "htslib/htslib/hfile.h"
 
-FASTQWriter::FASTQWriter(std::string filename){
+FASTQWriter::FASTQWriter(std::string filename, int compression_level, int num_threads, bool append){
   this->filename = filename;
-  output.open(filename.c_str());
+  std::string mode = (append ? "a" : "w");
+  mode += (compression_level == UNCOMPRESSED ? "u" : std::to_string(compression_level));
+  output = bgzf_open(filename.c_str(), mode.c_str());
+  if (output == NULL)
+    printErrorAndDie("Failed to open output file " + filename);
+  if (num_threads > 0 && bgzf_mt(output, num_threads, 256) != 0)
+    printErrorAndDie("Failed to enable multithreaded compression for output file " + filename);
+  buffer_.reserve(FLUSH_SIZE + 1024);
 }
 
 FASTQWriter::~FASTQWriter(){
   close();
 }
 
+void FASTQWriter::flush(){
+  if (!buffer_.empty() && bgzf_write(output, buffer_.data(), buffer_.size()) != (ssize_t)buffer_.size())
+    printErrorAndDie("Failed to write to output file " + filename);
+  buffer_.clear();
+}
+
 void FASTQWriter::close(){
-  output.close();
+  if (output == NULL)
+    return;
+  flush();
+  if (bgzf_close(output) != 0)
+    printErrorAndDie("Failed to close output file " + filename);
+  output = NULL;
 }
 
-void FASTQWriter::write_read(ReadInfo& read){
-  std::string bases = read.get_sequence();
-  std::string quals = read.get_quality();
+int64_t FASTQWriter::sync(){
+  flush();
+  if (bgzf_flush(output) != 0 || hflush(output->fp) != 0)
+    printErrorAndDie("Failed to write to output file " + filename);
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0)
+    printErrorAndDie("Failed to read the size of output file " + filename);
+  return info.st_size;
+}
+
+void FASTQWriter::write_read(ReadBatch& batch, size_t i, const char* comment){
+  StringView name  = batch.name(i);
+  StringView bases = batch.sequence(i);
+  StringView quals = batch.quality(i);
+
+  buffer_ += '@';
+  buffer_.append(name.data, name.size);
+  if (comment != NULL){
+    buffer_ += ' ';
+    buffer_ += comment;
+  }
+  buffer_ += '\n';
+  size_t bases_start = buffer_.size();
+  buffer_.append(bases.data, bases.size);
+  buffer_ += "\n+\n";
+  size_t quals_start = buffer_.size();
+  buffer_.append(quals.data, quals.size);
+  buffer_ += '\n';
 
-  if (read.reverse_complement()){
-    reverse_complement(bases);
-    std::reverse(quals.begin(), quals.end());
+  if (batch.reverse_complement()){
+    reverse_complement(&buffer_[bases_start], bases.size);
+    std::reverse(buffer_.begin() + quals_start, buffer_.begin() + quals_start + quals.size);
   }
 
-  output << "@"   << read.get_identifier() << "\n"
-	 << bases << "\n"
-	 << "+"   << "\n"
-	 << quals << "\n";
+  if (buffer_.size() >= FLUSH_SIZE)
+    flush();
 }
@@ -1,22 +1,49 @@
 #ifndef FASTQ_WRITER_H
 #define FASTQ_WRITER_H
 
-#include <fstream>
+#include <string>
 
-#include "bgzf_streams.h"
-#include "read_info.h"
+#include "htslib/htslib/bgzf.h"
+#include "read_batch.h"
 
+/*
+ * Writes records to a bgzipped or uncompressed FASTQ file, or to stdout if the path is "-". Records are formatted into
+ * a buffer that's handed to bgzf_write() in large chunks, rather than field by field. BGZF blocks can optionally be
+ * compressed on a pool of threads
+ */
 class FASTQWriter {
  private:
   std::string filename;
-  bgzfostream output;
+  BGZF* output;
+  std::string buffer_;   // Formatted records that haven't been passed to BGZF yet
+
+  const static size_t FLUSH_SIZE = 1 << 18;
+
+  void flush();
 
  public:
-  FASTQWriter(std::string filename);
+  const static int UNCOMPRESSED = -1;
+
+  /*
+   * compression_level ranges from 0 (stored blocks) to 9, or is UNCOMPRESSED for plain FASTQ.
+   * num_threads > 0 compresses blocks on that many threads. If append is true, records are added to the end of an
+   * existing file
+   */
+  FASTQWriter(std::string filename, int compression_level, int num_threads, bool append);
   ~FASTQWriter();
 
   void close();
-  void write_read(ReadInfo& read);
+
+  /*
+   * Passes every record written so far through BGZF to the file and returns the file's size. A BGZF block ends there,
+   * so the file can be truncated to that size and appended to
+   */
+  int64_t sync();
+  /* Writes the trimmed form of the batch's i-th read, undoing any reverse complementing done by the reader */
+  void write_read(ReadBatch& batch, size_t i){ write_read(batch, i, NULL); }
+
+  /* Same as above, but if comment isn't NULL it's appended to the identifier line after a space */
+  void write_read(ReadBatch& batch, size_t i, const char* comment);
 };
 
 #endif
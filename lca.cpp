@@ -41,42 +41,43 @@ void LCA::createBitStructures(){
 }
 
 void LCA::processTree(SuffixTree& tree){
-  if (tree.getNodes().size() > max_num_nodes)
-    printErrorAndDie("processTree()", "Number of nodes in tree exceeds the number allocated in LCA object");
-
-  // Compute I for each node
-  std::vector<Node*>& nodes = tree.getNodes();
-  for(int i = nodes.size()-1; i >= 0; i--){
-    int idx = i+1;
-    int val = rightmost[i+1]; 
-    std::vector<Node*> children = nodes[i]->getChildren();
-    for(int j = children.size()-1; j >= 0; j--){
-      if (rightmost[I[children[j]->getLabel()]] >= val){
-	idx = I[children[j]->getLabel()];
-	val = rightmost[idx];
-      }
-    }
-    run_heads[idx] = i+1;
-    I[i+1]         = idx;
+  int num_nodes = tree.getNumNodes();
+  reserve(num_nodes);
+
+  // Labels are 1-based DFS preorder indices, so children always have larger labels than their parents
+  const int32_t* parents = tree.getParents();
+
+  // Compute I for each node: the label in its subtree with the largest rightmost 1 bit.
+  // Processing labels in decreasing order finalizes each node before it's propagated to its parent
+  for(int i = 1; i <= num_nodes; i++)
+    I[i] = i;
+  for(int i = num_nodes; i > 1; i--){
+    int parent = parents[i-1]+1;
+    if (rightmost[I[i]] > rightmost[I[parent]])
+      I[parent] = I[i];
   }
 
+  // The head of each run is its node with the smallest label
+  for(int i = num_nodes; i >= 1; i--)
+    run_heads[I[i]] = i;
+
   // Compute Av for each node
   Av[1] = shifts[rightmost[I[1]]];
-  for(int i=2; i <= nodes.size(); i++)
-    Av[i] = (shifts[rightmost[I[i]]] | Av[nodes[i-1]->getParent()->getLabel()]);
+  for(int i=2; i <= num_nodes; i++)
+    Av[i] = (shifts[rightmost[I[i]]] | Av[parents[i-1]+1]);
 }
 
-Node* LCA::lca(SuffixTree& tree, Node* x, Node* y){
-  int id1 = x->getLabel();
-  int id2 = y->getLabel();
+int LCA::lcaNode(SuffixTree& tree, int x, int y){
+  int id1 = x+1;
+  int id2 = y+1;
 
   // Check if lca is x or y
-  if(id2 >= id1 && id2 <= id1 + x->getNumDescendants())
+  if(id2 >= id1 && id2 <= id1 + tree.getNumDescendants(x))
     return x;
-  else if(id1 >= id2 && id1 <= id2 + y->getNumDescendants())
+  else if(id1 >= id2 && id1 <= id2 + tree.getNumDescendants(y))
     return y;
 
-  std::vector<Node*>& nodes = tree.getNodes();
+  const int32_t* parents = tree.getParents();
   int idx, lca;
   if(I[id1] == I[id2])
     lca = I[id1];
@@ -100,35 +101,35 @@ Node* LCA::lca(SuffixTree& tree, Node* x, Node* y){
   // Determine x_bar
   l = rightmost[Av[id1]];
   if(l == j)
-    x_bar = x->getLabel();
+    x_bar = id1;
   else{
     int k   = leftmost[Av[id1] & (~ masks[j])];
     int num = (I[id1] & masks[k+1]) | shifts[k];
     int w   = run_heads[num];
-    x_bar   = nodes[w-1]->getParent()->getLabel();
+    x_bar   = parents[w-1]+1;
   }
 
   // Determine y_bar
   l = rightmost[Av[id2]];
   if (l == j)
-    y_bar = y->getLabel();
+    y_bar = id2;
   else {
     int k   = leftmost[Av[id2] & (~ masks[j])];
     int num = (I[id2] & masks[k+1]) | shifts[k];
     int w   = run_heads[num];
-    y_bar   = nodes[w-1]->getParent()->getLabel();
+    y_bar   = parents[w-1]+1;
   }
 
   if (x_bar < y_bar)
-    return nodes[x_bar-1];
+    return x_bar-1;
   else
-    return nodes[y_bar-1];  
+    return y_bar-1;
 }
 
-Node* LCA::lca(SuffixTree& tree, int sfx_idx_1, int sfx_idx_2){
-  return lca(tree, tree.getSuffix(sfx_idx_1), tree.getSuffix(sfx_idx_2));
+int LCA::lca(SuffixTree& tree, int sfx_idx_1, int sfx_idx_2){
+  return lcaNode(tree, tree.getSuffix(sfx_idx_1), tree.getSuffix(sfx_idx_2));
 }
 
 int LCA::longestPrefix(SuffixTree& tree, int sfx_idx_1, int sfx_idx_2){
-  return lca(tree, sfx_idx_1, sfx_idx_2)->getDepth();
+  return tree.getDepth(lca(tree, sfx_idx_1, sfx_idx_2));
 }
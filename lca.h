@@ -1,9 +1,13 @@
 #ifndef LCA_H
 #define LCA_H
 
+#include <algorithm>
+
+#include "lca_backend.h"
 #include "suffix_tree.h"
 
-class LCA {
+// Schieber-Vishkin LCA, which maps the tree onto a complete binary tree using the bits of the DFS numbering
+class LCA : public LCABackend {
   int  max_num_nodes;
   int  num_bits;
   int* rightmost;
@@ -20,8 +24,17 @@ class LCA {
  public:
   void processTree(SuffixTree& tree);
 
+  // max_nnodes is only the initial capacity, as processTree() grows the tables to fit larger trees
   LCA(int max_nnodes){
     max_num_nodes = max_nnodes;
+    allocate();
+  }
+
+  ~LCA(){
+    release();
+  }
+
+  void allocate(){
     setNumBits();
     leftmost  = new int [1<<num_bits];
     rightmost = new int [1<<num_bits];
@@ -33,7 +46,7 @@ class LCA {
     createBitStructures();
   }
 
-  ~LCA(){
+  void release(){
     delete [] leftmost;
     delete [] rightmost;
     delete [] shifts;
@@ -43,6 +56,16 @@ class LCA {
     delete [] Av;
   }
 
+  // Ensures the tables can accommodate trees with num_nodes nodes. Capacity at least doubles
+  // whenever it grows, so the tables are reallocated only a handful of times over a run
+  void reserve(int num_nodes){
+    if (num_nodes <= max_num_nodes)
+      return;
+    release();
+    max_num_nodes = std::max(num_nodes, 2*max_num_nodes);
+    allocate();
+  }
+
   void setNumBits(){
     num_bits  = 0;
     int val   = max_num_nodes;
@@ -52,8 +75,9 @@ class LCA {
     }
   }
 
-  Node* lca(SuffixTree& tree, Node* x, Node* y);
-  Node* lca(SuffixTree& tree, int sfx_idx_1, int sfx_idx_2);
+  // Nodes are identified by their DFS preorder index in the tree
+  int   lcaNode(SuffixTree& tree, int x, int y);
+  int   lca(SuffixTree& tree, int sfx_idx_1, int sfx_idx_2);
   int   longestPrefix(SuffixTree& tree, int sfx_idx_1, int sfx_idx_2);
 };
 
@@ -0,0 +1,27 @@
+#ifndef LCA_BACKEND_H
+#define LCA_BACKEND_H
+
+#include "suffix_tree.h"
+
+// Method used to answer lowest common ancestor queries on a suffix tree
+enum LCAMethod {
+  SCHIEBER_VISHKIN_LCA,  // Schieber-Vishkin bit tricks over the DFS numbering (LCA)
+  SPARSE_TABLE_LCA       // Sparse table range minimum queries over the DFS order (SparseTableLCA)
+};
+
+/*
+ * Lowest common ancestor queries on a suffix tree. processTree() must be called each time the tree
+ * is rebuilt, after which queries take constant time. Nodes are identified by their DFS preorder index
+ */
+class LCABackend {
+ public:
+  virtual ~LCABackend(){}
+
+  virtual void processTree(SuffixTree& tree) = 0;
+  virtual int  lcaNode(SuffixTree& tree, int x, int y) = 0;
+
+  /* Length of the longest common prefix of two suffixes, i.e. the string depth of their leaves' LCA */
+  virtual int  longestPrefix(SuffixTree& tree, int sfx_idx_1, int sfx_idx_2) = 0;
+};
+
+#endif
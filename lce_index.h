@@ -0,0 +1,30 @@
+#ifndef LCE_INDEX_H
+#define LCE_INDEX_H
+
+#include <string>
+
+#include "profiler.h"
+
+/*
+ * Longest common extension (LCE) index over a string of the form s1#s2. Implementations append
+ * a terminating $ character, so that every suffix of either read ends in a unique separator
+ * and matches never extend past the end of a read
+ */
+class LCEIndex {
+ protected:
+  StageProfile* profile_;  // Charged for index construction and preprocessing if not NULL
+
+ public:
+  LCEIndex(){ profile_ = NULL; }
+  virtual ~LCEIndex(){}
+
+  void set_profile(StageProfile* profile){ profile_ = profile; }
+
+  /* (Re)builds the index for the provided string, reusing the storage of any previous index */
+  virtual void build(const std::string& joined) = 0;
+
+  /* Returns the length of the longest common prefix of the suffixes starting at sfx_idx_1 and sfx_idx_2 */
+  virtual int longestPrefix(int sfx_idx_1, int sfx_idx_2) = 0;
+};
+
+#endif
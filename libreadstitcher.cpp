@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "libreadstitcher.h"
+#include "read_stitcher.h"
+#include "stringops.h"
+#include "version.h"
+
+static_assert(RS_STITCHED == (int)STITCHED && RS_UNSTITCHED == (int)UNSTITCHED && RS_TRIM_FAILED == (int)TRIM_FAILED && RS_N_SKIPPED == (int)N_SKIPPED,
+	      "Library status codes must match StitchStatus");
+
+struct rs_context {
+  ReadStitcher  stitcher;
+  ReadPairBatch batch;
+  std::vector<char> invalid;   // Whether each pair of the batch has a bad length or pointer, or a character other than ACGTN
+  bool valid_chars[256];
+
+  rs_context(const rs_params& p, StitchEngine engine, LCAMethod lca_method)
+    : stitcher(p.max_read_length, p.max_mismatches, p.min_overlap, p.min_frac_correct, p.seed_length, engine, lca_method){
+    std::fill(valid_chars, valid_chars+256, false);
+    valid_chars['A'] = valid_chars['C'] = valid_chars['G'] = valid_chars['T'] = valid_chars['N'] = true;
+  }
+
+  bool valid(const char* seq, const char* qual, int length){
+    if (length < 0 || (length > 0 && (seq == NULL || qual == NULL)))
+      return false;
+    for (int i = 0; i < length; i++)
+      if (!valid_chars[(unsigned char)seq[i]])
+	return false;
+    return true;
+  }
+};
+
+void rs_default_params(rs_params* params){
+  params->max_read_length  = 100;
+  params->max_mismatches   = 10;
+  params->min_overlap      = 10;
+  params->min_frac_correct = 0.9;
+  params->seed_length      = 8;
+  params->engine           = RS_ENGINE_BITPARALLEL;
+  params->lca_method       = RS_LCA_SPARSE_TABLE;
+  params->adapter_1        = NULL;
+  params->adapter_2        = NULL;
+}
+
+rs_context* rs_context_create(const rs_params* params){
+  if (params == NULL || params->max_read_length < 1 || params->seed_length < 0 || params->seed_length > 16)
+    return NULL;
+
+  StitchEngine engine;
+  switch (params->engine){
+  case RS_ENGINE_BITPARALLEL:  engine = BITPARALLEL_ENGINE;  break;
+  case RS_ENGINE_SUFFIX_TREE:  engine = SUFFIX_TREE_ENGINE;  break;
+  case RS_ENGINE_SUFFIX_ARRAY: engine = SUFFIX_ARRAY_ENGINE; break;
+  default: return NULL;
+  }
+
+  LCAMethod lca_method;
+  switch (params->lca_method){
+  case RS_LCA_SPARSE_TABLE:     lca_method = SPARSE_TABLE_LCA;     break;
+  case RS_LCA_SCHIEBER_VISHKIN: lca_method = SCHIEBER_VISHKIN_LCA; break;
+  default: return NULL;
+  }
+  std::string adapter_1 = (params->adapter_1 == NULL ? "" : params->adapter_1);
+  std::string adapter_2 = (params->adapter_2 == NULL ? "" : params->adapter_2);
+  if (adapter_1.find_first_not_of("ACGT") != std::string::npos || adapter_2.find_first_not_of("ACGT") != std::string::npos)
+    return NULL;
+
+  rs_context* context = new rs_context(*params, engine, lca_method);
+  context->stitcher.set_adapters(adapter_1, adapter_2, false);
+  return context;
+}
+
+void rs_context_destroy(rs_context* context){
+  delete context;
+}
+
+int rs_stitch_batch(rs_context* context, const rs_pair* pairs, rs_result* results, size_t num_pairs){
+  ReadPairBatch& batch = context->batch;
+  batch.clear();
+  batch.reads_2.set_reverse_complement(true);
+  context->invalid.assign(num_pairs, 0);
+
+  // Copy the pairs into the context's batch, reverse complementing read 2 as FASTQReader does. Invalid pairs are
+  // added as empty reads, which keeps the indices aligned and can't be stitched
+  int ret = 0;
+  for (size_t i = 0; i < num_pairs; i++){
+    const rs_pair& pair = pairs[i];
+    bool valid = (context->valid(pair.seq_1, pair.qual_1, pair.len_1) && context->valid(pair.seq_2, pair.qual_2, pair.len_2));
+    if (!valid){
+      context->invalid[i] = 1;
+      ret = -1;
+    }
+    batch.reads_1.add("", 0, pair.seq_1, pair.qual_1, (valid ? pair.len_1 : 0));
+    size_t index = batch.reads_2.add("", 0, NULL, NULL, (valid ? pair.len_2 : 0));
+    if (valid){
+      char* seq  = batch.reads_2.mutable_sequence(index);
+      char* qual = batch.reads_2.mutable_quality(index);
+      std::copy(pair.seq_2, pair.seq_2 + pair.len_2, seq);
+      reverse_complement(seq, pair.len_2);
+      std::reverse_copy(pair.qual_2, pair.qual_2 + pair.len_2, qual);
+    }
+  }
+
+  size_t stitch_index = 0;
+  for (size_t i = 0; i < num_pairs; i++){
+    rs_result& result = results[i];
+    result.length = 0;
+    if (context->invalid[i]){
+      result.status = RS_UNSTITCHED;
+      continue;
+    }
+    StitchStatus status = context->stitcher.stitch_pair(batch, i);
+    result.status = status;
+    if (status != STITCHED)
+      continue;
+
+    StringView seq  = batch.stitched.sequence(stitch_index);
+    StringView qual = batch.stitched.quality(stitch_index);
+    stitch_index++;
+    if (seq.size > result.capacity){
+      ret = -1;
+      continue;
+    }
+    std::copy(seq.data,  seq.data  + seq.size,  result.seq);
+    std::copy(qual.data, qual.data + qual.size, result.qual);
+    result.length = seq.size;
+  }
+  return ret;
+}
+
+const char* rs_version(){
+  return VERSION.c_str();
+}
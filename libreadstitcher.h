@@ -0,0 +1,98 @@
+#ifndef LIBREADSTITCHER_H
+#define LIBREADSTITCHER_H
+
+#include <stddef.h>
+
+/*
+ * C interface to the stitcher, for programs that stitch read pairs in-process rather than through FASTQ files.
+ *
+ * A context holds everything a stitcher needs between pairs: the overlap index, the seed filter and its scratch
+ * space, and the batch the pairs are copied into. Contexts share no state, so each thread creates its own and
+ * any number of contexts can stitch concurrently. Buffers grow to fit the largest batch a context has seen and
+ * are then reused, so steady-state calls don't allocate.
+ *
+ * Link with -lreadstitcher -lhts -lz -lpthread, or against libreadstitcher.so
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Outcome of stitching a pair, with the same meanings as the ReadStitcher binary's statistics */
+enum {
+  RS_STITCHED       = 0,  /* The pair was merged into a single read */
+  RS_UNSTITCHED     = 1,  /* No overlap met the requirements */
+  RS_TRIM_FAILED    = 2,  /* At least one read was empty after trimming N tails and low quality ends */
+  RS_N_SKIPPED      = 3   /* At least one read contained an N after trimming */
+};
+
+enum {
+  RS_ENGINE_BITPARALLEL  = 0,
+  RS_ENGINE_SUFFIX_TREE  = 1,
+  RS_ENGINE_SUFFIX_ARRAY = 2
+};
+
+enum {
+  RS_LCA_SPARSE_TABLE     = 0,
+  RS_LCA_SCHIEBER_VISHKIN = 1
+};
+
+/* Stitching parameters. rs_default_params() fills in the defaults of the ReadStitcher binary */
+typedef struct {
+  int    max_read_length;    /* Expected read length, used to size the initial buffers */
+  int    max_mismatches;
+  int    min_overlap;
+  double min_frac_correct;
+  int    seed_length;        /* 0 disables the seed filter */
+  int    engine;             /* One of RS_ENGINE_* */
+  int    lca_method;         /* One of RS_LCA_*, used by RS_ENGINE_SUFFIX_TREE */
+  const char* adapter_1;     /* Adapters trimmed from the 3' ends of the reads as sequenced, or NULL. Only A, C, G and T */
+  const char* adapter_2;
+} rs_params;
+
+/* A pair of reads in caller-owned buffers. Read 2 is given as sequenced, and is reverse complemented internally */
+typedef struct {
+  const char* seq_1;
+  const char* qual_1;
+  int         len_1;
+  const char* seq_2;
+  const char* qual_2;
+  int         len_2;
+} rs_pair;
+
+/*
+ * Result for a pair. seq and qual point to caller-provided buffers of at least capacity bytes. len_1 + len_2 bytes
+ * always suffice. The stitched read is in the orientation of read 1 and isn't NUL-terminated
+ */
+typedef struct {
+  char* seq;
+  char* qual;
+  int   capacity;
+  int   status;              /* One of RS_STITCHED, RS_UNSTITCHED, RS_TRIM_FAILED or RS_N_SKIPPED */
+  int   length;              /* Length of the stitched read, or 0 if the pair wasn't stitched */
+} rs_result;
+
+typedef struct rs_context rs_context;
+
+void rs_default_params(rs_params* params);
+
+/* Returns NULL if the parameters are invalid */
+rs_context* rs_context_create(const rs_params* params);
+void        rs_context_destroy(rs_context* context);
+
+/*
+ * Trims and stitches num_pairs pairs, writing one result per pair. Returns 0 on success and -1 if a stitched read
+ * didn't fit in its result's buffers or a read was invalid: a negative length, a NULL sequence or quality string, or a
+ * character other than ACGTN. Every result is filled in either way: invalid pairs are RS_UNSTITCHED and stitched
+ * reads that didn't fit have a length of 0
+ */
+int rs_stitch_batch(rs_context* context, const rs_pair* pairs, rs_result* results, size_t num_pairs);
+
+/* Version of the library, which matches that of the ReadStitcher binary */
+const char* rs_version();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
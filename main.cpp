@@ -1,13 +1,14 @@
 #include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <getopt.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "error.h"
-#include "kmer_counter.h"
-#include "lca.h"
 #include "read_stitcher.h"
+#include "shard_index.h"
 #include "stringops.h"
 #include "version.h"
 
@@ -15,77 +16,49 @@ int    max_read_len;
 int    max_k;
 int    min_bp_overlap;
 double min_frac_correct;
+int    seed_length;
+int    num_threads;
+int    io_threads;
+int    compression_level;
+double checkpoint_interval;
+std::string engine_name;
+std::string lca_name;
 
 bool file_exists(std::string path){
   return (access(path.c_str(), F_OK) != -1);
 }
 
-void printStitching(std::string& s1, std::string& s2, int index){
-  std::cout << s1 << std::endl;
-  std::string spacing = "";
-  for (int i = 0; i < index; i++)
-    spacing += " ";
-  std::cout << spacing << s2 << std::endl;
-}
-
-void generateSequences(int num_seqs, int seq_length, std::vector<std::string>& seqs){
-  srand(1187238845);
-  char bases[4] = {'A', 'C', 'G', 'T'};
-  seqs.clear();
-  for(int i = 0; i < num_seqs; i++){
-    std::string res = "";
-    for(int j = 0; j < seq_length; j++){
-      res += bases[rand()%4];
-    }
-    seqs.push_back(res);
-  }
-}
-
-void mutate(std::vector<std::string>& reads, double mutation_rate){
-  mutation_rate *= 4.0/3.0; // 1 out of 4 times we mutate the base to itself
-  char bases[4]  = {'A', 'C', 'G', 'T'};
-  for(int i = 0; i < reads.size(); i++){
-    for(int j = 0; j < reads[i].size(); j++){
-      double f = ((double)rand())/RAND_MAX;
-      if (f <= mutation_rate)
-	reads[i][j] = bases[rand()%4];
-    }
-  }
-}
-
-void generateReads(int num_reads, int read_length, std::vector<std::string>& reads_a, std::vector<std::string>& reads_b, 
-		   std::vector<int>& pos_a, std::vector<int>& pos_b, double mutation_rate){
-  std::vector<std::string> seqs;
-  int seq_length = 2*read_length;
-  generateSequences(num_reads, seq_length, seqs);
-  reads_a.clear();
-  reads_b.clear();
-  pos_a.clear();
-  pos_b.clear();
-  for(int i = 0; i < num_reads; i++){
-    int loc_a = rand()%(seq_length-read_length+1);
-    int loc_b = rand()%(seq_length-read_length-loc_a+1) + loc_a;
-    reads_a.push_back(seqs[i].substr(loc_a, read_length));
-    reads_b.push_back(seqs[i].substr(loc_b, read_length));
-    pos_a.push_back(loc_a);
-    pos_b.push_back(loc_b);
-  }
-  
-  mutate(reads_a, mutation_rate);
-  mutate(reads_b, mutation_rate);
-}
 
 void print_usage(){
    std::cout
       << "Usage: ReadStitcher --f1 <fq_1.gz> --f2 <fq_2.gz> --out <prefix> --log <log_file.txt> [options]"                        << "\n"
-      << "\t" << "--f1               <fq_1.gz>      " << "\t" << " Bgzipped FASTQ containing first  set of reads"                 << "\n"
-      << "\t" << "--f2               <fq_2.gz>      " << "\t" << " Bgzipped FASTQ containing second set of reads"                 << "\n"
-      << "\t" << "--out              <prefix>       " << "\t" << " Prefix for output files for stitched and unstitched reads"     << "\n"
+      << "\t" << "--f1               <fq_1.gz>      " << "\t" << " FASTQ containing first  set of reads, or - for stdin. Can be bgzipped, gzipped or uncompressed" << "\n"
+      << "\t" << "--f2               <fq_2.gz>      " << "\t" << " FASTQ containing second set of reads, or - for stdin"          << "\n"
+      << "\t" << "--interleaved                     " << "\t" << " --f1 contains both reads of each pair in consecutive records, and --f2 isn't used" << "\n"
+      << "\t" << "--out              <prefix>       " << "\t" << " Prefix for output files for stitched and unstitched reads, or - to write"        << "\n"
+      << "\t" << "                                  " << "\t" << " an uncompressed interleaved FASTQ to stdout, tagged ZS:Z:stitched or ZS:Z:unstitched" << "\n"
+      << "\t" << "--shard            <i/N>          " << "\t" << " Only stitch the i-th of N record-aligned slices of the input, from 1/N to N/N. The outputs"  << "\n"
+      << "\t" << "                                  " << "\t" << " of all N shards concatenate into those of a single run. Needs bgzipped or uncompressed files" << "\n"
+      << "\t" << "--build-index                     " << "\t" << " Write the <fastq>.rsi split point indexes used by --shard for the input files and exit" << "\n"
+      << "\t" << "--checkpoint-interval <SECONDS>  " << "\t" << " Seconds between checkpoints written to <prefix>.checkpoint, or 0 to disable them (Default = " << checkpoint_interval << ")" << "\n"
+      << "\t" << "--resume                          " << "\t" << " Truncate the outputs to the last checkpoint and continue from there, rather than starting over" << "\n"
       << "\t" << "--log              <log_file.txt> " << "\t" << " Path for log file output"                                      << "\n"
+      << "\t" << "--stats            <stats_file>   " << "\t" << " Path for a report of the stitching statistics, as JSON if it ends in .json and TSV otherwise" << "\n"
+      << "\t" << "--adapter1         <SEQ>          " << "\t" << " Adapter trimmed from the 3' ends of the first  reads before stitching"  << "\n"
+      << "\t" << "--adapter2         <SEQ>          " << "\t" << " Adapter trimmed from the 3' ends of the second reads before stitching"  << "\n"
+      << "\t" << "--infer-adapters                  " << "\t" << " Infer any adapter that isn't given from the read-through pairs at the start of the input. Not available with --shard" << "\n"
       << "\t" << "--min-frac-correct <FLOAT>        " << "\t" << " Minimum fraction of overlapping bases that must match (Default = "  << min_frac_correct << ")" << "\n"
-      << "\t" << "--max-read-length  <INT>          " << "\t" << " Maximum read length to be considered (Default = "                   << max_read_len     << ")" << "\n"
+      << "\t" << "--max-read-length  <INT>          " << "\t" << " Read length used to size initial buffers, which grow as needed (Default = " << max_read_len     << ")" << "\n"
       << "\t" << "--max-mismatches   <INT>          " << "\t" << " Maximum number of overlapping bases that can not match (Default = " << max_k            << ")" << "\n"
       << "\t" << "--min-overlap      <INT>          " << "\t" << " Minimum number of overlapping bases required (Default = "           << min_bp_overlap   << ")" << "\n"
+      << "\t" << "--engine           <STRING>       " << "\t" << " Overlap detection engine: bitparallel, suffix-tree or suffix-array (Default = " << engine_name << ")" << "\n"
+      << "\t" << "--lca              <STRING>       " << "\t" << " LCA method for the suffix-tree engine: schieber-vishkin or sparse-table (Default = " << lca_name << ")" << "\n"
+      << "\t" << "--seed-length      <INT>          " << "\t" << " Length of the exact seeds used to rule out offsets, or 0 to verify every offset (Default = " << seed_length << ")" << "\n"
+      << "\t" << "--threads          <INT>          " << "\t" << " Number of threads used to stitch reads (Default = "                 << num_threads      << ")" << "\n"
+      << "\t" << "--io-threads       <INT>          " << "\t" << " Number of extra threads used to (de)compress each input and output file (Default = " << io_threads << ")" << "\n"
+      << "\t" << "--compression-level <INT>         " << "\t" << " BGZF compression level for the output files, from 0 (uncompressed blocks) to 9 (Default = " << compression_level << ")" << "\n"
+      << "\t" << "--profile                         " << "\t" << " Write the time and allocations of each stitching stage to the log"                  << "\n"
+      << "\t" << "--profile-counters                " << "\t" << " Same as --profile, but also reads CPU cycle, instruction and cache miss counters" << "\n"
       << "\t" << "--help                            " << "\t" << " Print this help message and exit"                                                              << "\n"
       << "\t" << "--version                         " << "\t" << " Print ReadStitcher version and exit"                                                           << "\n" << std::endl;
     exit(0);
@@ -98,11 +71,21 @@ int main(int argc, char **argv){
   max_k             = 10;
   min_bp_overlap    = 10;
   min_frac_correct  = 0.9;
+  seed_length       = 8;
+  num_threads       = 1;
+  io_threads        = 0;
+  compression_level = 6;
+  checkpoint_interval = 60;
+  engine_name       = "bitparallel";
+  lca_name          = "sparse-table";
   std::string f1    = "";
   std::string f2    = "";
   std::string out   = "";
   std::string log   = "";
-  int print_version = 0, print_help = 0;
+  std::string stats = "";
+  std::string shard = "";
+  std::string adapter_1 = "", adapter_2 = "";
+  int print_version = 0, print_help = 0, profile = 0, profile_counters = 0, interleaved = 0, build_index = 0, resume = 0, infer_adapters = 0;
   
   if (argc == 1)
     print_usage();
@@ -110,12 +93,29 @@ int main(int argc, char **argv){
   static struct option long_options[] = {
     {"f1",               required_argument, 0, 'a'},
     {"f2",               required_argument, 0, 'b'},
+    {"adapter1",         required_argument, 0, 'd'},
+    {"adapter2",         required_argument, 0, 'n'},
+    {"engine",           required_argument, 0, 'e'},
+    {"lca",              required_argument, 0, 'c'},
     {"min-frac-correct", required_argument, 0, 'f'},
     {"max-read-length",  required_argument, 0, 'l'},
     {"max-mismatches",   required_argument, 0, 'm'},
     {"min-overlap",      required_argument, 0, 'o'},
     {"out",              required_argument, 0, 'p'},
     {"log",              required_argument, 0, 'r'},
+    {"stats",            required_argument, 0, 'j'},
+    {"shard",            required_argument, 0, 'g'},
+    {"checkpoint-interval", required_argument, 0, 'k'},
+    {"seed-length",      required_argument, 0, 's'},
+    {"threads",          required_argument, 0, 't'},
+    {"io-threads",       required_argument, 0, 'i'},
+    {"compression-level", required_argument, 0, 'z'},
+    {"interleaved",      no_argument, &interleaved,      1},
+    {"build-index",      no_argument, &build_index,      1},
+    {"resume",           no_argument, &resume,           1},
+    {"infer-adapters",   no_argument, &infer_adapters,   1},
+    {"profile",          no_argument, &profile,          1},
+    {"profile-counters", no_argument, &profile_counters, 1},
     {"help",        no_argument, &print_help,    1},
     {"version",     no_argument, &print_version, 1},
     {0, 0, 0, 0}
@@ -124,7 +124,7 @@ int main(int argc, char **argv){
   int c;
   while (true){
     int option_index = 0;
-    c = getopt_long(argc, argv, "a:b:f:l:m:o:", long_options, &option_index);
+    c = getopt_long(argc, argv, "a:b:c:d:e:f:g:i:j:k:l:m:n:o:s:t:z:", long_options, &option_index);
     if (c == -1)
       break;
     switch (c){
@@ -136,9 +136,33 @@ int main(int argc, char **argv){
     case 'b':
       f2 = std::string(optarg);
       break;
+    case 'c':
+      lca_name = std::string(optarg);
+      break;
+    case 'd':
+      adapter_1 = uppercase(std::string(optarg));
+      break;
+    case 'n':
+      adapter_2 = uppercase(std::string(optarg));
+      break;
+    case 'e':
+      engine_name = std::string(optarg);
+      break;
     case 'f':
       min_frac_correct = atof(optarg);
       break;
+    case 'g':
+      shard = std::string(optarg);
+      break;
+    case 'i':
+      io_threads = atoi(optarg);
+      break;
+    case 'j':
+      stats = std::string(optarg);
+      break;
+    case 'k':
+      checkpoint_interval = atof(optarg);
+      break;
     case 'l':
       max_read_len = atoi(optarg);
       break;
@@ -154,6 +178,15 @@ int main(int argc, char **argv){
     case 'r':
       log = std::string(optarg);
       break;
+    case 's':
+      seed_length = atoi(optarg);
+      break;
+    case 't':
+      num_threads = atoi(optarg);
+      break;
+    case 'z':
+      compression_level = atoi(optarg);
+      break;
     case '?':
       printErrorAndDie("Unrecognized command line option");
       break;
@@ -182,19 +215,71 @@ int main(int argc, char **argv){
 
   if (f1.empty())
     printErrorAndDie("--f1 argument required");
-  if (f2.empty())
+  if (interleaved == 1 && !f2.empty())
+    printErrorAndDie("--f2 can't be used with --interleaved");
+  if (interleaved == 0 && f2.empty())
     printErrorAndDie("--f2 argument required");
+  if (f1.compare("-") == 0 && f2.compare("-") == 0)
+    printErrorAndDie("Only one of --f1 and --f2 can read from stdin");
+  if (build_index == 1){
+    if (f1.compare("-") == 0 || f2.compare("-") == 0)
+      printErrorAndDie("--build-index can't be used with stdin");
+    ShardIndex f1_index(f1, std::cerr);
+    if (!f2.empty())
+      ShardIndex f2_index(f2, std::cerr);
+    exit(0);
+  }
+  int shard_index = 1, num_shards = 1;
+  if (!shard.empty()){
+    std::vector<std::string> fields = split_string(shard, '/');
+    if (fields.size() == 2){
+      shard_index = atoi(fields[0].c_str());
+      num_shards  = atoi(fields[1].c_str());
+    }
+    if (fields.size() != 2 || num_shards < 1 || shard_index < 1 || shard_index > num_shards)
+      printErrorAndDie("Argument to --shard must be of the form i/N, where 1 <= i <= N");
+    if (f1.compare("-") == 0 || f2.compare("-") == 0)
+      printErrorAndDie("--shard can't be used with stdin");
+    if (infer_adapters == 1 && num_shards > 1)
+      printErrorAndDie("--infer-adapters can't be used with --shard, as each shard would infer its own adapters. Pass them with --adapter1 and --adapter2 instead");
+  }
   if (out.empty())
     printErrorAndDie("--out argument required");
   if (log.empty())
     printErrorAndDie("--log argument required");
-  if (!string_ends_with(f1, ".gz"))
-    printErrorAndDie("Argument to --f1 must be a bgzipped FASTQ file (and end in .gz)");
-  if (!string_ends_with(f2, ".gz"))
-    printErrorAndDie("Argument to --f2 must be a bgzipped FASTQ file (and end in .gz)");
-  if (!file_exists(f1))
+  StitchEngine engine;
+  if (engine_name.compare("bitparallel") == 0)
+    engine = BITPARALLEL_ENGINE;
+  else if (engine_name.compare("suffix-tree") == 0)
+    engine = SUFFIX_TREE_ENGINE;
+  else if (engine_name.compare("suffix-array") == 0)
+    engine = SUFFIX_ARRAY_ENGINE;
+  else
+    printErrorAndDie("Argument to --engine must be one of bitparallel, suffix-tree or suffix-array");
+  LCAMethod lca_method;
+  if (lca_name.compare("schieber-vishkin") == 0)
+    lca_method = SCHIEBER_VISHKIN_LCA;
+  else if (lca_name.compare("sparse-table") == 0)
+    lca_method = SPARSE_TABLE_LCA;
+  else
+    printErrorAndDie("Argument to --lca must be either schieber-vishkin or sparse-table");
+  if (seed_length < 0 || seed_length > 16)
+    printErrorAndDie("--seed-length must be between 0 and 16");
+  if (num_threads < 1)
+    printErrorAndDie("--threads must be at least 1");
+  if (io_threads < 0)
+    printErrorAndDie("--io-threads must be at least 0");
+  if (compression_level < 0 || compression_level > 9)
+    printErrorAndDie("--compression-level must be between 0 and 9");
+  if (checkpoint_interval < 0)
+    printErrorAndDie("--checkpoint-interval must be at least 0");
+  if (adapter_1.find_first_not_of("ACGT") != std::string::npos)
+    printErrorAndDie("Argument to --adapter1 can only contain A, C, G and T");
+  if (adapter_2.find_first_not_of("ACGT") != std::string::npos)
+    printErrorAndDie("Argument to --adapter2 can only contain A, C, G and T");
+  if (f1.compare("-") != 0 && !file_exists(f1))
     printErrorAndDie("Argument to --f1 is not a valid file path");
-  if (!file_exists(f2))
+  if (!f2.empty() && f2.compare("-") != 0 && !file_exists(f2))
     printErrorAndDie("Argument to --f2 is not a valid file path");
 
   std::ofstream log_stream;
@@ -202,26 +287,15 @@ int main(int argc, char **argv){
   if (!log_stream.is_open())
     printErrorAndDie("Failed to open the log file: " + log);
   
-  ReadStitcher stitcher(max_read_len, max_k, min_bp_overlap, min_frac_correct);
-  std::vector<std::string> l_reads;
-  std::vector<std::string> r_reads;
-  std::vector<int>         l_start;
-  std::vector<int>         r_start;
-  
-  //100,100
-
-  /*  
-  generateReads(10000, max_read_len, l_reads, r_reads, l_start, r_start, 0.01);
-  for(int i = 0; i < l_reads.size(); i++){
-    int best_frac_idx = stitcher.stitch_reads(l_reads[i], r_reads[i]);
-    if (best_frac_idx != -1){
-      printStitching(l_reads[i], r_reads[i], best_frac_idx);
-      std::cout << std::endl;
-    }
-  }
-  */
-
-  stitcher.stitch_fastq(f1, f2, out, log_stream);
+  ReadStitcher stitcher(max_read_len, max_k, min_bp_overlap, min_frac_correct, seed_length, engine, lca_method);
+  stitcher.set_shard(shard_index-1, num_shards);
+  stitcher.set_checkpoints(checkpoint_interval, resume == 1);
+  stitcher.set_adapters(adapter_1, adapter_2, infer_adapters == 1);
+  if (profile == 1 || profile_counters == 1)
+    stitcher.enable_profiling(profile_counters == 1);
+  stitcher.stitch_fastq(f1, f2, out, num_threads, io_threads, compression_level, log_stream);
   stitcher.print_base_qual_stats(log_stream);
   log_stream.close();
+  if (!stats.empty())
+    stitcher.write_stats(stats);
 }
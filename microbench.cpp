@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "error.h"
+#include "lca.h"
+#include "profiler.h"
+#include "read_simulator.h"
+#include "read_stitcher.h"
+#include "sparse_table_lca.h"
+#include "stringops.h"
+#include "suffix_tree.h"
+
+/*
+ * Microbenchmarks for the per-pair kernels: suffix tree construction, LCA preprocessing, longest common prefix
+ * queries, kMismatch and merge_read_information. Each kernel is swept over read lengths and sequencing error rates
+ * using pairs from ReadSimulator. A repetition runs the kernel once on every pair and the reported cycles, time and
+ * allocations per operation are the medians over the repetitions. Cycles are TSC ticks where available and
+ * allocations are counted by the operator new in alloc_counter.cpp. Results can be compared against a baseline written
+ * by an earlier run, which flags kernels that slowed down or allocate more than the threshold allows
+ */
+
+static inline uint64_t read_cycles(){
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Accumulates the cost of the timed sections of one repetition
+class Sample {
+public:
+  uint64_t cycles;
+  double   nanoseconds;
+  int64_t  allocations;
+  int64_t  ops;
+
+  Sample(){ cycles = 0; nanoseconds = 0; allocations = 0; ops = 0; }
+};
+
+// Times the enclosing scope and adds it to a sample
+class Timer {
+  Sample& sample_;
+  int64_t ops_;
+  int64_t allocations_;
+  uint64_t cycles_;
+  std::chrono::steady_clock::time_point start_;
+
+public:
+  Timer(Sample& sample, int64_t ops) : sample_(sample){
+    ops_         = ops;
+    allocations_ = thread_allocations();
+    start_       = std::chrono::steady_clock::now();
+    cycles_      = read_cycles();
+  }
+
+  ~Timer(){
+    uint64_t cycles = read_cycles();
+    sample_.nanoseconds += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_).count();
+    sample_.cycles      += cycles - cycles_;
+    sample_.allocations += thread_allocations() - allocations_;
+    sample_.ops         += ops_;
+  }
+};
+
+class Result {
+public:
+  std::string kernel;
+  int    read_length;
+  double error_rate;
+  double cycles, nanoseconds, allocations;  // Per operation
+
+  std::string key() const {
+    std::stringstream ss;
+    ss << kernel << "\t" << read_length << "\t" << error_rate;
+    return ss.str();
+  }
+};
+
+static double median(std::vector<double> values){
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  return (n % 2 == 1 ? values[n/2] : 0.5*(values[n/2-1] + values[n/2]));
+}
+
+// Input shared by the kernels for one read length and error rate
+class KernelInput {
+public:
+  std::vector<SimulatedPair> pairs;
+  std::vector<std::string> joined;           // s1#s2 for each pair, as indexed by the suffix tree engine
+  std::vector<std::pair<int, int> > queries; // Suffix pairs for the longest prefix queries
+  ReadBatch upstream, downstream;            // Pairs in stitching order, for merge_read_information
+  int read_length;
+};
+
+static void make_input(int read_length, double error_rate, int num_pairs, uint32_t seed, KernelInput& input){
+  // Fragments are long enough that the first read is almost always upstream, with a spread of overlaps
+  ReadSimulator simulator(seed, read_length, 1.5*read_length, 0.2*read_length, error_rate, 0, 0);
+  std::mt19937 rng(seed);
+  input.read_length = read_length;
+  input.pairs.resize(num_pairs);
+  for (int i = 0; i < num_pairs; i++){
+    SimulatedPair& pair = input.pairs[i];
+    simulator.next_pair(pair);
+    input.joined.push_back(pair.seq_1 + "#" + pair.seq_2);
+
+    bool reverse = pair.read_2_upstream;
+    const std::string& s1 = (reverse ? pair.seq_2 : pair.seq_1), &q1 = (reverse ? pair.qual_2 : pair.qual_1);
+    const std::string& s2 = (reverse ? pair.seq_1 : pair.seq_2), &q2 = (reverse ? pair.qual_1 : pair.qual_2);
+    input.upstream.add(pair.name.data(), pair.name.size(), s1.data(), q1.data(), s1.size());
+    input.downstream.add(pair.name.data(), pair.name.size(), s2.data(), q2.data(), s2.size());
+  }
+  int num_suffixes = 2*read_length+1;
+  for (int i = 0; i < 1024; i++)
+    input.queries.push_back(std::pair<int, int>(rng() % num_suffixes, rng() % num_suffixes));
+}
+
+typedef void (*Kernel)(KernelInput& input, Sample& sample);
+
+static void bench_suffix_tree(KernelInput& input, Sample& sample){
+  static SuffixTree tree;
+  Timer timer(sample, input.joined.size());
+  for (size_t i = 0; i < input.joined.size(); i++)
+    tree.build(input.joined[i]);
+}
+
+static void bench_process_tree(LCABackend& lca, KernelInput& input, Sample& sample){
+  static SuffixTree tree;
+  for (size_t i = 0; i < input.joined.size(); i++){
+    tree.build(input.joined[i]);
+    Timer timer(sample, 1);
+    lca.processTree(tree);
+  }
+}
+
+static void bench_longest_prefix(LCABackend& lca, KernelInput& input, Sample& sample){
+  static SuffixTree tree;
+  int64_t total = 0;
+  for (size_t i = 0; i < input.joined.size(); i++){
+    tree.build(input.joined[i]);
+    lca.processTree(tree);
+    Timer timer(sample, input.queries.size());
+    for (size_t j = 0; j < input.queries.size(); j++)
+      total += lca.longestPrefix(tree, input.queries[j].first, input.queries[j].second);
+  }
+  // Keeps the queries from being optimized away
+  if (total < 0)
+    std::cerr << total << std::endl;
+}
+
+static void bench_schieber_vishkin_process(KernelInput& input, Sample& sample){
+  static LCA lca(2*(2*input.read_length+2));
+  bench_process_tree(lca, input, sample);
+}
+
+static void bench_sparse_table_process(KernelInput& input, Sample& sample){
+  static SparseTableLCA lca;
+  bench_process_tree(lca, input, sample);
+}
+
+static void bench_schieber_vishkin_query(KernelInput& input, Sample& sample){
+  static LCA lca(2*(2*input.read_length+2));
+  bench_longest_prefix(lca, input, sample);
+}
+
+static void bench_sparse_table_query(KernelInput& input, Sample& sample){
+  static SparseTableLCA lca;
+  bench_longest_prefix(lca, input, sample);
+}
+
+static void bench_kmismatch(StitchEngine engine, KernelInput& input, Sample& sample){
+  static std::map<StitchEngine, ReadStitcher*> stitchers;
+  if (stitchers.find(engine) == stitchers.end())
+    stitchers[engine] = new ReadStitcher(input.read_length, 10, 10, 0.9, 0, engine, SPARSE_TABLE_LCA);
+  ReadStitcher* stitcher = stitchers[engine];
+
+  int best_frac_idx, num_bp_overlap, num_mismatches;
+  double best_frac;
+  Timer timer(sample, input.pairs.size());
+  for (size_t i = 0; i < input.pairs.size(); i++)
+    stitcher->kMismatch(input.pairs[i].seq_1, input.pairs[i].seq_2, &best_frac_idx, &best_frac, num_bp_overlap, num_mismatches);
+}
+
+static void bench_kmismatch_bitparallel(KernelInput& input, Sample& sample) { bench_kmismatch(BITPARALLEL_ENGINE,  input, sample); }
+static void bench_kmismatch_suffix_tree(KernelInput& input, Sample& sample) { bench_kmismatch(SUFFIX_TREE_ENGINE,  input, sample); }
+static void bench_kmismatch_suffix_array(KernelInput& input, Sample& sample){ bench_kmismatch(SUFFIX_ARRAY_ENGINE, input, sample); }
+
+static void bench_merge(KernelInput& input, Sample& sample){
+  static ReadStitcher stitcher(input.read_length, 10, 10, 0.9, 0, BITPARALLEL_ENGINE, SPARSE_TABLE_LCA);
+  static ReadBatch merged;
+  merged.clear();
+  Timer timer(sample, input.pairs.size());
+  for (size_t i = 0; i < input.pairs.size(); i++){
+    int offset = std::min(input.pairs[i].offset, input.read_length-1);
+    stitcher.merge_read_information(input.upstream, input.downstream, i, offset, input.read_length-offset, 0, merged);
+  }
+}
+
+class KernelInfo {
+public:
+  const char* name;
+  Kernel kernel;
+};
+
+static const KernelInfo KERNELS[] = {
+  {"suffix_tree_build",            bench_suffix_tree},
+  {"schieber_vishkin_process",     bench_schieber_vishkin_process},
+  {"sparse_table_process",         bench_sparse_table_process},
+  {"schieber_vishkin_query",       bench_schieber_vishkin_query},
+  {"sparse_table_query",           bench_sparse_table_query},
+  {"kmismatch_bitparallel",        bench_kmismatch_bitparallel},
+  {"kmismatch_suffix_tree",        bench_kmismatch_suffix_tree},
+  {"kmismatch_suffix_array",       bench_kmismatch_suffix_array},
+  {"merge_read_information",       bench_merge}
+};
+
+static Result run_kernel(const KernelInfo& info, KernelInput& input, double error_rate, int num_reps){
+  std::vector<double> cycles, nanoseconds, allocations;
+
+  // The first repetition warms up the caches and grows any reusable storage to its final size
+  for (int rep = 0; rep <= num_reps; rep++){
+    Sample sample;
+    info.kernel(input, sample);
+    if (rep == 0)
+      continue;
+    cycles.push_back(1.0*sample.cycles/sample.ops);
+    nanoseconds.push_back(sample.nanoseconds/sample.ops);
+    allocations.push_back(1.0*sample.allocations/sample.ops);
+  }
+
+  Result result;
+  result.kernel      = info.name;
+  result.read_length = input.read_length;
+  result.error_rate  = error_rate;
+  result.cycles      = median(cycles);
+  result.nanoseconds = median(nanoseconds);
+  result.allocations = median(allocations);
+  return result;
+}
+
+static const char* HEADER = "kernel\tread_length\terror_rate\tcycles/op\tns/op\tallocs/op";
+
+static void write_result(const Result& result, std::ostream& out){
+  out << result.key() << "\t" << std::fixed << std::setprecision(1) << result.cycles << "\t" << result.nanoseconds
+      << "\t" << std::setprecision(3) << result.allocations << std::defaultfloat << std::endl;
+}
+
+static void read_baseline(const std::string& path, std::map<std::string, Result>& baseline){
+  std::ifstream input(path.c_str());
+  if (!input.is_open())
+    printErrorAndDie("Failed to open the baseline file " + path);
+  std::string line;
+  while (std::getline(input, line)){
+    if (line.empty() || line[0] == '#' || line.compare(HEADER) == 0)
+      continue;
+    std::vector<std::string> tokens = split_string(line, '\t');
+    if (tokens.size() != 6)
+      printErrorAndDie("Malformed line in the baseline file: " + line);
+    Result result;
+    result.kernel      = tokens[0];
+    result.read_length = atoi(tokens[1].c_str());
+    result.error_rate  = atof(tokens[2].c_str());
+    result.cycles      = atof(tokens[3].c_str());
+    result.nanoseconds = atof(tokens[4].c_str());
+    result.allocations = atof(tokens[5].c_str());
+    baseline[result.key()] = result;
+  }
+}
+
+/* Prints the kernels that are slower or allocate more than the baseline allows. Returns the number of regressions */
+static int compare_to_baseline(const std::vector<Result>& results, std::map<std::string, Result>& baseline, double threshold){
+  int num_regressions = 0;
+  std::cout << "\nkernel\tread_length\terror_rate\tcycles_ratio\tallocs/op\tbaseline_allocs/op\tstatus\n";
+  for (size_t i = 0; i < results.size(); i++){
+    auto iter = baseline.find(results[i].key());
+    if (iter == baseline.end())
+      continue;
+    const Result& base = iter->second;
+    double ratio = results[i].cycles/base.cycles;
+    bool slower  = ratio > 1+threshold;
+    // Allocation counts are deterministic, so any increase beyond rounding is a regression
+    bool allocs  = results[i].allocations > base.allocations + 0.0005;
+    num_regressions += (slower || allocs);
+    std::cout << results[i].key() << "\t" << std::fixed << std::setprecision(3) << ratio << "\t" << results[i].allocations
+	      << "\t" << base.allocations << std::defaultfloat << "\t"
+	      << (slower ? (allocs ? "SLOWER,ALLOCS" : "SLOWER") : (allocs ? "ALLOCS" : "OK")) << "\n";
+  }
+  std::cout << std::endl;
+  return num_regressions;
+}
+
+static void print_usage(){
+  std::cout
+    << "Usage: ReadStitcherMicrobench [options]"                                                                                   << "\n"
+    << "\t" << "--kernels          <LIST>         " << "\t" << " Comma-separated kernels to run (Default = all)"                  << "\n"
+    << "\t" << "--read-lengths     <LIST>         " << "\t" << " Comma-separated read lengths (Default = 100,150,250)"            << "\n"
+    << "\t" << "--error-rates      <LIST>         " << "\t" << " Comma-separated per-base error rates (Default = 0,0.01,0.05)"    << "\n"
+    << "\t" << "--pairs            <INT>          " << "\t" << " Number of pairs each repetition runs on (Default = 256)"         << "\n"
+    << "\t" << "--reps             <INT>          " << "\t" << " Number of timed repetitions (Default = 15)"                      << "\n"
+    << "\t" << "--baseline         <FILE>         " << "\t" << " Compare the results to a baseline and exit with status 1 on any regression" << "\n"
+    << "\t" << "--threshold        <FLOAT>        " << "\t" << " Allowed fractional increase in cycles/op over the baseline (Default = 0.2)" << "\n"
+    << "\t" << "--write-baseline   <FILE>         " << "\t" << " Write the results to a new baseline file"                        << "\n" << std::endl;
+  exit(0);
+}
+
+int main(int argc, char** argv){
+  std::string kernels        = "";
+  std::string read_lengths   = "100,150,250";
+  std::string error_rates    = "0,0.01,0.05";
+  std::string baseline_file  = "";
+  std::string output_file    = "";
+  int    num_pairs           = 256;
+  int    num_reps            = 15;
+  double threshold           = 0.2;
+  int    print_help          = 0;
+
+  static struct option long_options[] = {
+    {"kernels",        required_argument, 0, 'k'},
+    {"read-lengths",   required_argument, 0, 'l'},
+    {"error-rates",    required_argument, 0, 'e'},
+    {"pairs",          required_argument, 0, 'n'},
+    {"reps",           required_argument, 0, 'r'},
+    {"baseline",       required_argument, 0, 'b'},
+    {"threshold",      required_argument, 0, 'x'},
+    {"write-baseline", required_argument, 0, 'w'},
+    {"help",      no_argument, &print_help, 1},
+    {0, 0, 0, 0}
+  };
+
+  int c;
+  while ((c = getopt_long(argc, argv, "b:e:k:l:n:r:w:x:", long_options, NULL)) != -1){
+    switch (c){
+    case 0:   break;
+    case 'b': baseline_file = optarg;       break;
+    case 'e': error_rates   = optarg;       break;
+    case 'k': kernels       = optarg;       break;
+    case 'l': read_lengths  = optarg;       break;
+    case 'n': num_pairs     = atoi(optarg); break;
+    case 'r': num_reps      = atoi(optarg); break;
+    case 'w': output_file   = optarg;       break;
+    case 'x': threshold     = atof(optarg); break;
+    default:
+      printErrorAndDie("Unrecognized command line option");
+    }
+  }
+  if (print_help == 1)
+    print_usage();
+  if (num_pairs < 1 || num_reps < 1)
+    printErrorAndDie("--pairs and --reps must be at least 1");
+
+  std::vector<KernelInfo> selected;
+  std::vector<std::string> kernel_names = split_string(kernels, ',');
+  for (size_t i = 0; i < sizeof(KERNELS)/sizeof(KERNELS[0]); i++)
+    if (kernels.empty() || std::find(kernel_names.begin(), kernel_names.end(), KERNELS[i].name) != kernel_names.end())
+      selected.push_back(KERNELS[i]);
+  if (selected.empty())
+    printErrorAndDie("--kernels did not match any kernel");
+
+  std::vector<Result> results;
+  std::vector<std::string> lengths = split_string(read_lengths, ','), rates = split_string(error_rates, ',');
+  std::cout << HEADER << std::endl;
+  for (size_t l = 0; l < lengths.size(); l++){
+    for (size_t r = 0; r < rates.size(); r++){
+      int read_length   = atoi(lengths[l].c_str());
+      double error_rate = atof(rates[r].c_str());
+      if (read_length < 1)
+	printErrorAndDie("Read lengths must be at least 1");
+      KernelInput input;
+      make_input(read_length, error_rate, num_pairs, 1187238845, input);
+      for (size_t k = 0; k < selected.size(); k++){
+	results.push_back(run_kernel(selected[k], input, error_rate, num_reps));
+	write_result(results.back(), std::cout);
+      }
+    }
+  }
+
+  if (!output_file.empty()){
+    std::ofstream output(output_file.c_str());
+    if (!output.is_open())
+      printErrorAndDie("Failed to open the baseline file " + output_file);
+    output << HEADER << "\n";
+    for (size_t i = 0; i < results.size(); i++)
+      write_result(results[i], output);
+  }
+
+  if (!baseline_file.empty()){
+    std::map<std::string, Result> baseline;
+    read_baseline(baseline_file, baseline);
+    int num_regressions = compare_to_baseline(results, baseline, threshold);
+    if (num_regressions != 0){
+      std::cout << num_regressions << " kernel(s) regressed beyond the baseline" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -5,7 +5,7 @@ import matplotlib.pyplot  as plt
 import matplotlib.patches as patchs
 import matplotlib.image   as mpimg
 
-import gzip
+import json
 import numpy
 import pandas
 import seaborn
@@ -13,24 +13,15 @@ import seaborn
 import sys
 
 def main():
-    fastq  = sys.argv[1]
-    log    = sys.argv[2]
-    output = sys.argv[3]
-
-    data           = gzip.open(fastq)
-    count          = 0
-    num_overlaps   = []
-    num_mismatches = []
-    for line in data:
-        if count % 4 == 0:
-            tokens = line.decode().strip().split("_")
-            num_overlaps.append(int(tokens[1]))
-            num_mismatches.append(int(tokens[2]))
-        count += 1
-    data.close()
-
-    num_overlaps   = numpy.array(num_overlaps)
-    num_mismatches = numpy.array(num_mismatches)
+    stats  = sys.argv[1]
+    output = sys.argv[2]
+
+    # Expand the joint histogram from ReadStitcher's --stats JSON report into one entry per stitched read
+    with open(stats) as data:
+        report = json.load(data)
+    bins           = numpy.array(report["overlap_mismatches"], dtype=numpy.int64).reshape(-1, 3)
+    num_overlaps   = numpy.repeat(bins[:,0], bins[:,2])
+    num_mismatches = numpy.repeat(bins[:,1], bins[:,2])
     df = pandas.DataFrame({'Number of Overlapping Bases':num_overlaps, 'Number of Mismatched Bases':num_mismatches})
     pp = PdfPages(output)
     print("Plotting joint distribution")
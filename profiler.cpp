@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <iomanip>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "profiler.h"
+
+static const char* STAGE_NAMES[NUM_PROFILE_STAGES] = {"decompress", "parse", "trim", "n_scan", "seed_filter", "index_build",
+						      "lca_preprocess", "overlap_search", "merge", "write"};
+
+// Replaced by alloc_counter.cpp in the binaries. Library users keep their own operator new, so nothing is counted
+__attribute__((weak)) int64_t thread_allocations(){ return 0; }
+
+StageProfile::StageProfile(bool use_counters){
+  use_counters_      = use_counters;
+  counter_fd_        = (use_counters ? -2 : -1);
+  counters_available = false;
+  mark_allocations_  = 0;
+  std::fill(counter_fds_, counter_fds_+NUM_PROFILE_COUNTERS, -1);
+  std::fill(mark_counters_, mark_counters_+NUM_PROFILE_COUNTERS, 0);
+  std::fill(calls,       calls+NUM_PROFILE_STAGES,       0);
+  std::fill(seconds,     seconds+NUM_PROFILE_STAGES,     0);
+  std::fill(allocations, allocations+NUM_PROFILE_STAGES, 0);
+  for (int i = 0; i < NUM_PROFILE_STAGES; i++)
+    std::fill(counters[i], counters[i]+NUM_PROFILE_COUNTERS, 0);
+}
+
+StageProfile::~StageProfile(){
+  for (int i = 0; i < NUM_PROFILE_COUNTERS; i++)
+    if (counter_fds_[i] >= 0)
+      close(counter_fds_[i]);
+}
+
+void StageProfile::open_counters(){
+  counter_fd_ = -1;
+#ifdef __linux__
+  const uint64_t configs[NUM_PROFILE_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+  for (int i = 0; i < NUM_PROFILE_COUNTERS; i++){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = configs[i];
+    attr.read_format    = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    int group = (i == 0 ? -1 : counter_fds_[0]);
+    counter_fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+    if (counter_fds_[i] < 0){
+      // Usually a container or a perf_event_paranoid setting that doesn't allow user space counters
+      for (int j = 0; j < i; j++){
+	close(counter_fds_[j]);
+	counter_fds_[j] = -1;
+      }
+      return;
+    }
+  }
+  counter_fd_        = counter_fds_[0];
+  counters_available = true;
+#endif
+}
+
+void StageProfile::read_counters(uint64_t* values){
+  uint64_t buffer[1+NUM_PROFILE_COUNTERS];
+  if (counter_fd_ < 0 || read(counter_fd_, buffer, sizeof(buffer)) != (ssize_t)sizeof(buffer)){
+    std::fill(values, values+NUM_PROFILE_COUNTERS, 0);
+    return;
+  }
+  std::copy(buffer+1, buffer+1+NUM_PROFILE_COUNTERS, values);
+}
+
+void StageProfile::charge(){
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  int64_t now_allocations = thread_allocations();
+  uint64_t now_counters[NUM_PROFILE_COUNTERS];
+  if (counter_fd_ >= 0)
+    read_counters(now_counters);
+
+  if (!stack_.empty()){
+    ProfileStage stage  = stack_.back();
+    seconds[stage]     += std::chrono::duration<double>(now - mark_time_).count();
+    allocations[stage] += now_allocations - mark_allocations_;
+    if (counter_fd_ >= 0)
+      for (int i = 0; i < NUM_PROFILE_COUNTERS; i++)
+	counters[stage][i] += now_counters[i] - mark_counters_[i];
+  }
+
+  mark_time_        = now;
+  mark_allocations_ = now_allocations;
+  if (counter_fd_ >= 0)
+    std::copy(now_counters, now_counters+NUM_PROFILE_COUNTERS, mark_counters_);
+}
+
+void StageProfile::enter(ProfileStage stage){
+  if (counter_fd_ == -2)
+    open_counters();
+  charge();
+  stack_.push_back(stage);
+  calls[stage]++;
+}
+
+void StageProfile::leave(){
+  charge();
+  stack_.pop_back();
+}
+
+void StageProfile::merge(const StageProfile& other){
+  for (int i = 0; i < NUM_PROFILE_STAGES; i++){
+    calls[i]       += other.calls[i];
+    seconds[i]     += other.seconds[i];
+    allocations[i] += other.allocations[i];
+    for (int j = 0; j < NUM_PROFILE_COUNTERS; j++)
+      counters[i][j] += other.counters[i][j];
+  }
+  counters_available |= other.counters_available;
+}
+
+void StageProfile::print(std::ostream& out){
+  double total = 0;
+  for (int i = 0; i < NUM_PROFILE_STAGES; i++)
+    total += seconds[i];
+
+  out << "Stage profile (exclusive time summed over all threads)" << "\n"
+      << "stage\tcalls\tseconds\tpct_time\tallocations";
+  if (counters_available)
+    out << "\tcycles\tinstructions\tIPC\tcache_misses";
+  out << "\n";
+  for (int i = 0; i < NUM_PROFILE_STAGES; i++){
+    out << STAGE_NAMES[i] << "\t" << calls[i] << "\t" << std::fixed << std::setprecision(4) << seconds[i] << "\t"
+	<< std::setprecision(2) << (total > 0 ? 100.0*seconds[i]/total : 0.0) << "\t" << allocations[i];
+    if (counters_available){
+      double ipc = (counters[i][COUNTER_CYCLES] > 0 ? 1.0*counters[i][COUNTER_INSTRUCTIONS]/counters[i][COUNTER_CYCLES] : 0.0);
+      out << "\t" << counters[i][COUNTER_CYCLES] << "\t" << counters[i][COUNTER_INSTRUCTIONS] << "\t" << ipc
+	  << "\t" << counters[i][COUNTER_CACHE_MISSES];
+    }
+    out << std::defaultfloat << "\n";
+  }
+  if (use_counters_ && !counters_available)
+    out << "Hardware counters were requested but perf_event_open() is unavailable" << "\n";
+  out << std::endl;
+}
@@ -0,0 +1,97 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Stages of stitch_fastq that --profile times separately
+enum ProfileStage {
+  STAGE_DECOMPRESS,     // bgzf_read() calls that refill the FASTQ readers
+  STAGE_PARSE,          // Splitting records, reverse complementing and copying them into batches
+  STAGE_TRIM,           // Trimming N tails and low quality ends
+  STAGE_N_SCAN,         // Checking the trimmed reads for N bases
+  STAGE_SEED_FILTER,    // Finding the candidate offsets of each pair
+  STAGE_INDEX_BUILD,    // Suffix tree, suffix array and LCP or packed read construction
+  STAGE_LCA_PREPROCESS, // LCA or range minimum query tables
+  STAGE_OVERLAP_SEARCH, // LCE queries or bit-parallel comparisons at each offset
+  STAGE_MERGE,          // Building the stitched reads
+  STAGE_WRITE,          // Formatting, compressing and writing the outputs
+  NUM_PROFILE_STAGES
+};
+
+// Hardware events read through perf_event_open(2) when they're requested
+enum ProfileCounter {
+  COUNTER_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  COUNTER_CACHE_MISSES,
+  NUM_PROFILE_COUNTERS
+};
+
+/* Number of allocations made through operator new on the calling thread, or 0 if alloc_counter.cpp isn't linked in */
+int64_t thread_allocations();
+
+/*
+ * Time, allocations and optionally hardware counters for each stage, accumulated by a single thread.
+ * Stages nest: entering a stage pauses the enclosing one, so each stage is only charged for its own work.
+ * Hardware counters are opened on the first thread that enters a stage, as perf events count the thread
+ * that opened them
+ */
+class StageProfile {
+ private:
+  bool    use_counters_;
+  int     counter_fd_;           // Leader of the perf event group. -1 if unavailable and -2 if not yet opened
+  int     counter_fds_[NUM_PROFILE_COUNTERS];
+  std::vector<ProfileStage> stack_;
+  std::chrono::steady_clock::time_point mark_time_;
+  int64_t mark_allocations_;
+  uint64_t mark_counters_[NUM_PROFILE_COUNTERS];
+
+  void open_counters();
+  void read_counters(uint64_t* values);
+  // Charges everything since the last mark to the current stage and starts a new mark
+  void charge();
+
+  StageProfile(const StageProfile&);
+  StageProfile& operator=(const StageProfile&);
+
+ public:
+  int64_t  calls[NUM_PROFILE_STAGES];
+  double   seconds[NUM_PROFILE_STAGES];
+  int64_t  allocations[NUM_PROFILE_STAGES];
+  uint64_t counters[NUM_PROFILE_STAGES][NUM_PROFILE_COUNTERS];
+  bool     counters_available;
+
+  StageProfile(bool use_counters);
+  ~StageProfile();
+
+  void enter(ProfileStage stage);
+  void leave();
+
+  void merge(const StageProfile& other);
+
+  /* Writes a table with a row per stage to the log */
+  void print(std::ostream& out);
+};
+
+// Charges the enclosing scope to a stage. Does nothing if the profile is NULL, so it can be left in hot paths
+class ProfileScope {
+ private:
+  StageProfile* profile_;
+
+ public:
+  ProfileScope(StageProfile* profile, ProfileStage stage){
+    profile_ = profile;
+    if (profile_ != NULL)
+      profile_->enter(stage);
+  }
+
+  ~ProfileScope(){
+    if (profile_ != NULL)
+      profile_->leave();
+  }
+};
+
+#endif
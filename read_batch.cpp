@@ -0,0 +1,59 @@
+#include "read_batch.h"
+
+size_t ReadBatch::add(const char* name, int name_len, const char* sequence, const char* quality, int length){
+  name_start_.push_back(names_.size());
+  name_len_.push_back(name_len);
+  names_.insert(names_.end(), name, name+name_len);
+
+  seq_start_.push_back(sequences_.size());
+  seq_len_.push_back(length);
+  if (sequence != NULL){
+    sequences_.insert(sequences_.end(), sequence, sequence+length);
+    qualities_.insert(qualities_.end(), quality, quality+length);
+  }
+  else {
+    sequences_.resize(sequences_.size()+length);
+    qualities_.resize(qualities_.size()+length);
+  }
+  ltrim_.push_back(0);
+  rtrim_.push_back(0);
+  return size()-1;
+}
+
+void ReadBatch::trimNTails(size_t i){
+  StringView seq = sequence(i);
+  int start = 0, end = seq.size-1;
+  while (start < seq.size){
+    if (seq[start] != 'N')
+      break;
+    start++;
+  }
+
+  while (end >= start){
+    if (seq[end] != 'N')
+      break;
+    end--;
+  }
+
+  ltrim_[i] += start;
+  rtrim_[i] += seq.size-1-end;
+}
+
+void ReadBatch::trimLowQualityEnds(size_t i, char min_qual){
+  StringView qual = quality(i);
+  int start = 0, end = qual.size-1;
+  while (start < qual.size){
+    if (qual[start] >= min_qual)
+      break;
+    start++;
+  }
+
+  while (end >= start){
+    if (qual[end] >= min_qual)
+      break;
+    end--;
+  }
+
+  ltrim_[i] += start;
+  rtrim_[i] += qual.size-1-end;
+}
@@ -0,0 +1,65 @@
+#ifndef READ_BATCH_H
+#define READ_BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "string_view.h"
+
+/*
+ * A batch of reads stored in contiguous arenas. The identifiers, sequences and quality scores of all of the reads are
+ * appended to three character arenas and located through per-record offset and length arrays. Trimming only adjusts
+ * the per-record trim amounts. Clearing a batch keeps the capacity of all of its arrays, so a batch that's recycled
+ * through the pipeline stops allocating once it has held its largest set of reads
+ */
+class ReadBatch {
+ private:
+  std::vector<char> names_, sequences_, qualities_;  // Quality scores share the offsets of the sequences
+  std::vector<size_t> name_start_, seq_start_;
+  std::vector<int> name_len_, seq_len_;
+  std::vector<int> ltrim_, rtrim_;                   // Amount of each sequence and its quality scores that's been trimmed
+  bool rev_comp_;                                    // Whether the reads were reverse complemented when they were read
+
+ public:
+  ReadBatch(){ rev_comp_ = false; }
+
+  void clear(){
+    names_.clear();
+    sequences_.clear();
+    qualities_.clear();
+    name_start_.clear();
+    seq_start_.clear();
+    name_len_.clear();
+    seq_len_.clear();
+    ltrim_.clear();
+    rtrim_.clear();
+  }
+
+  size_t size()                 { return seq_start_.size(); }
+  bool reverse_complement()     { return rev_comp_; }
+  void set_reverse_complement(bool rev_complement){ rev_comp_ = rev_complement; }
+
+  /* Appends an untrimmed read and returns its index. If sequence and quality are NULL, their contents are left to be filled through the mutable accessors */
+  size_t add(const char* name, int name_len, const char* sequence, const char* quality, int length);
+
+  StringView name(size_t i)     { return StringView(names_.data() + name_start_[i], name_len_[i]); }
+  StringView sequence(size_t i) { return StringView(sequences_.data() + seq_start_[i] + ltrim_[i], length(i)); }
+  StringView quality(size_t i)  { return StringView(qualities_.data() + seq_start_[i] + ltrim_[i], length(i)); }
+  int  length(size_t i)         { return seq_len_[i] - ltrim_[i] - rtrim_[i]; }
+  bool empty(size_t i)          { return length(i) == 0; }
+  int  trimmed(size_t i)        { return ltrim_[i] + rtrim_[i]; }
+  int  left_trimmed(size_t i)   { return ltrim_[i]; }
+
+  /* Only valid until the next read is added */
+  char* mutable_sequence(size_t i){ return sequences_.data() + seq_start_[i] + ltrim_[i]; }
+  char* mutable_quality(size_t i) { return qualities_.data() + seq_start_[i] + ltrim_[i]; }
+
+  /* Removes num_bases from the end of the sequence as sequenced, which is its start if it's been reverse complemented */
+  void trimAdapter(size_t i, int num_bases){ (rev_comp_ ? ltrim_[i] : rtrim_[i]) += num_bases; }
+
+  void trimNTails(size_t i);
+
+  void trimLowQualityEnds(size_t i, char min_qual);
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "read_simulator.h"
+
+ReadSimulator::ReadSimulator(uint32_t seed, int read_length, double insert_mean, double insert_sd, double error_rate, double n_rate, double swap_rate)
+  : rng_(seed){
+  read_length_ = read_length;
+  insert_mean_ = insert_mean;
+  insert_sd_   = insert_sd;
+  error_rate_  = error_rate;
+  n_rate_      = n_rate;
+  swap_rate_   = swap_rate;
+  num_pairs_   = 0;
+}
+
+// Box-Muller transform, so that the fragment lengths don't depend on the standard library's distributions
+double ReadSimulator::normal(){
+  return sqrt(-2.0*log(uniform()))*cos(2*M_PI*uniform());
+}
+
+void ReadSimulator::sequence_read(int start, std::string& seq, std::string& qual){
+  seq.assign(fragment_, start, read_length_);
+  qual.resize(read_length_);
+  double mutation_rate = error_rate_*4.0/3.0; // 1 out of 4 times we mutate the base to itself
+  for (int j = 0; j < read_length_; j++){
+    if (uniform() < n_rate_){
+      seq[j]  = 'N';
+      qual[j] = '#';
+      continue;
+    }
+    if (uniform() < mutation_rate)
+      seq[j] = random_base();
+    qual[j] = '5' + rng_()%('J'-'5');
+  }
+}
+
+void ReadSimulator::next_pair(SimulatedPair& pair){
+  int insert = std::max(1, (int)lround(insert_mean_ + insert_sd_*normal()));
+
+  // Fragments shorter than the reads are flanked by enough adapter sequence for both reads
+  int flank = std::max(0, read_length_ - insert);
+  fragment_.resize(flank + insert + flank);
+  for (size_t j = 0; j < fragment_.size(); j++)
+    fragment_[j] = random_base();
+
+  int start_1 = flank;
+  int start_2 = flank + insert - read_length_;
+  sequence_read(start_1, pair.seq_1, pair.qual_1);
+  sequence_read(start_2, pair.seq_2, pair.qual_2);
+  pair.read_2_upstream = (start_2 < start_1);
+  pair.offset          = std::abs(start_2 - start_1);
+
+  if (uniform() < swap_rate_){
+    pair.seq_1.swap(pair.seq_2);
+    pair.qual_1.swap(pair.qual_2);
+    pair.read_2_upstream = !pair.read_2_upstream;
+  }
+
+  std::stringstream name;
+  name << "sim" << num_pairs_++ << "_" << insert;
+  pair.name = name.str();
+}
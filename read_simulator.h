@@ -0,0 +1,47 @@
+#ifndef READ_SIMULATOR_H
+#define READ_SIMULATOR_H
+
+#include <stdint.h>
+
+#include <random>
+#include <string>
+
+// A simulated pair of reads, both on the forward strand of their fragment (as read 2 is after FASTQReader reverse complements it)
+class SimulatedPair {
+public:
+  std::string name;
+  std::string seq_1, qual_1;
+  std::string seq_2, qual_2;
+  bool read_2_upstream;   // True if the second read starts before the first one in the fragment
+  int  offset;            // Start of the downstream read relative to the start of the upstream read
+};
+
+/*
+ * Generates reproducible pairs of reads from random fragments. Fragment lengths are drawn from a normal distribution
+ * and each read covers one end of its fragment. Reads longer than their fragment continue into random adapter sequence,
+ * which places the second read upstream of the first. Sequencing errors substitute random bases and N bases are given
+ * the lowest quality score. Mates are optionally swapped to simulate fragments sequenced from the opposite strand
+ */
+class ReadSimulator {
+private:
+  std::mt19937 rng_;
+  int    read_length_;
+  double insert_mean_, insert_sd_;
+  double error_rate_;
+  double n_rate_;
+  double swap_rate_;
+  int64_t num_pairs_;
+  std::string fragment_;
+
+  double uniform(){ return (rng_() + 0.5)/4294967296.0; }
+  double normal();
+  char   random_base(){ return "ACGT"[rng_() & 3]; }
+  void   sequence_read(int start, std::string& seq, std::string& qual);
+
+public:
+  ReadSimulator(uint32_t seed, int read_length, double insert_mean, double insert_sd, double error_rate, double n_rate, double swap_rate);
+
+  void next_pair(SimulatedPair& pair);
+};
+
+#endif
@@ -1,23 +1,84 @@
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <fstream>
+#include <map>
 #include <sstream>
+#include <thread>
 
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
 #include "error.h"
 #include "fastq_reader.h"
 #include "fastq_writer.h"
 #include "read_stitcher.h"
+#include "seed_filter.h"
+#include "shard_index.h"
 #include "stringops.h"
+#include "suffix_array.h"
+#include "suffix_tree_lce.h"
+#include "work_queue.h"
 
-ReadStitcher::ReadStitcher(int max_read_len, int max_k, int min_bp_overlap, double min_frac_correct){
+ReadStitcher::ReadStitcher(int max_read_len, int max_k, int min_bp_overlap, double min_frac_correct, int seed_length, StitchEngine engine, LCAMethod lca_method){
   this->max_read_len      = max_read_len;
   this->max_k             = max_k;
   this->min_bp_overlap    = min_bp_overlap;
   this->min_frac_correct  = min_frac_correct;
-  lca = new LCA(2*(2*max_read_len+2)); // +2 due to separator character and terminating character
+  this->seed_length       = seed_length;
+  this->engine            = engine;
+  this->lca_method        = lca_method;
+  if (engine == SUFFIX_TREE_ENGINE)
+    lce_ = new SuffixTreeLCE(lca_method, 2*(2*max_read_len+2)); // +2 due to separator character and terminating character. Grows for longer reads
+  else if (engine == SUFFIX_ARRAY_ENGINE)
+    lce_ = new SuffixArray();
+  else
+    lce_ = NULL;
+  seed_filter_ = (seed_length > 0 ? new SeedFilter(seed_length, max_k, min_bp_overlap, min_frac_correct) : NULL);
+  profile_          = NULL;
+  profile_counters_ = false;
+  shard_            = 0;
+  num_shards_       = 1;
+  pairs_left_       = -1;
+  checkpoint_interval_ = 0;
+  resume_           = false;
+  infer_adapters_   = false;
+  adapter_trimmer_  = NULL;
 }
 
 ReadStitcher::~ReadStitcher(){
-  delete lca;
+  delete lce_;
+  delete seed_filter_;
+  delete adapter_trimmer_;
+  delete profile_;
+}
+
+void ReadStitcher::enable_profiling(bool hardware_counters){
+  delete profile_;
+  profile_          = new StageProfile(hardware_counters);
+  profile_counters_ = hardware_counters;
+  if (lce_ != NULL)
+    lce_->set_profile(profile_);
+}
+
+void ReadStitcher::set_shard(int shard, int num_shards){
+  shard_      = shard;
+  num_shards_ = num_shards;
+}
+
+void ReadStitcher::set_adapters(const std::string& adapter_1, const std::string& adapter_2, bool infer){
+  adapters_[0]    = adapter_1;
+  adapters_[1]    = adapter_2;
+  infer_adapters_ = infer;
+  delete adapter_trimmer_;
+  adapter_trimmer_ = (adapter_1.empty() && adapter_2.empty() ? NULL : new AdapterTrimmer(adapter_1, adapter_2));
+}
+
+void ReadStitcher::set_checkpoints(double interval, bool resume){
+  checkpoint_interval_ = interval;
+  resume_              = resume;
 }
 
 void ReadStitcher::printStitching(const std::string& s1, const std::string& s2, int index){
@@ -28,33 +89,96 @@ void ReadStitcher::printStitching(const std::string& s1, const std::string& s2,
   std::cout << spacing << s2 << std::endl;
 }
 
+void ReadStitcher::prepare_pair(const StringView& s1, const StringView& s2){
+  len_1_ = s1.size;
+  len_2_ = s2.size;
+  if (engine == BITPARALLEL_ENGINE){
+    ProfileScope scope(profile_, STAGE_INDEX_BUILD);
+    bitparallel_.prepare(s1, s2);
+    return;
+  }
+
+  // A single index over s1#s2$ answers longest common extension queries for both orientations
+  joined_.assign(s1.data, s1.size);
+  joined_ += '#';
+  joined_.append(s2.data, s2.size);
+  lce_->build(joined_);
+}
+
 void ReadStitcher::kMismatch(const std::string& s1, const std::string& s2, int* best_frac_idx, double* best_frac, int& num_bp_overlap, int& num_mismatches){
-  std::string exp = s1 + '#' + s2;
-  char separator  = '#';
-  SuffixTree tree(exp);
+  prepare_pair(s1, s2);
+  kMismatchOriented(false, NULL, best_frac_idx, best_frac, num_bp_overlap, num_mismatches);
+}
+
+void ReadStitcher::kMismatchOriented(bool reverse, const char* candidates, int* best_frac_idx, double* best_frac, int& num_bp_overlap, int& num_mismatches){
+  ProfileScope scope(profile_, STAGE_OVERLAP_SEARCH);
+  if (engine == BITPARALLEL_ENGINE){
+    bitparallel_.kMismatch(reverse, max_k, min_bp_overlap, min_frac_correct, candidates, search_stats_, best_frac_idx, best_frac, num_bp_overlap, num_mismatches);
+    return;
+  }
+
+  // Lengths of the upstream (first) and downstream (second) reads, and the offsets of their suffixes in s1#s2$
+  int len_first   = (reverse ? len_2_ : len_1_);
+  int len_second  = (reverse ? len_1_ : len_2_);
+  int base_first  = (reverse ? len_1_+1 : 0);
+  int base_second = (reverse ? 0 : len_1_+1);
 
-  lca->processTree(tree);
   *best_frac      = 0;
   *best_frac_idx  = -1;
   num_bp_overlap  = -1;
   num_mismatches  = -1;
-  //*max_matches    = -1;
-  //*max_match_idx  = -1;
 
-  for (int i = 0; i < ((int)s1.size()) - min_bp_overlap; i++){
+  int num_offsets = std::max(0, len_first - min_bp_overlap);
+  search_stats_.offsets += num_offsets;
+  for (int i = 0; i < num_offsets; i++){
+    if (candidates != NULL && !candidates[i]){
+      search_stats_.offsets_filtered++;
+      continue;
+    }
+
+    // An offset is only accepted if its fraction exceeds both of these, so limit is the most mismatches it can contain
+    double threshold = std::max(*best_frac, min_frac_correct);
+    int limit;
+    if (len_first - i > len_second){
+      // The second read ends within the first: the overlap is len_second+1 and the end of the read counts as a mismatch
+      limit = (len_second >= min_bp_overlap ? std::min(max_k-1, max_mismatches_above(len_second+1, threshold)-1) : -1);
+      if (limit < 0){
+	// The bound is the same for every offset at which the second read ends within the first
+	int next = std::min(len_first - len_second, num_offsets);
+	search_stats_.offsets_skipped += next - i;
+	i = next - 1;
+	continue;
+      }
+    }
+    else {
+      // The first read ends within the second. Even a perfect match can't succeed once the threshold reaches 1
+      limit = std::min(max_k, max_mismatches_above(len_first - i, threshold));
+      if (limit < 0){
+	search_stats_.offsets_skipped += num_offsets - i;
+	return;
+      }
+    }
+
     int sfx_offset_1 = 0;
     int sfx_offset_2 = 0;
+    bool aborted     = false;
 
     int k;
     for (k = 0; k < max_k; k++){
       // +1 due the way in which we increment the offsets (as we assume the match is followed by a mismatch)
-      if (sfx_offset_2 == 1+s2.size())
+      if (sfx_offset_2 == 1+len_second)
 	break;
 
-      // +1 due to separator character
-      int nmatch = lca->longestPrefix(tree, i+sfx_offset_1, s1.size()+1+sfx_offset_2);
+      // All k mismatches so far are within the overlap, so the offset can no longer succeed
+      if (k > limit){
+	aborted = true;
+	break;
+      }
 
-      if (exp[i+sfx_offset_1+nmatch] == separator){
+      // Each read is followed by a unique separator, so matches never extend past the end of either read
+      int nmatch = lce_->longestPrefix(base_first+i+sfx_offset_1, base_second+sfx_offset_2);
+
+      if (i+sfx_offset_1+nmatch == len_first){
 	sfx_offset_1 += nmatch;
 	sfx_offset_2 += nmatch;
 	break;
@@ -64,9 +188,13 @@ void ReadStitcher::kMismatch(const std::string& s1, const std::string& s2, int*
       sfx_offset_2 += nmatch+1;
     }
 
+    if (aborted){
+      search_stats_.walks_aborted++;
+      continue;
+    }
 
     // Check if stitching was successful
-    if (i+sfx_offset_1 == s1.size() || (s2.size() >= min_bp_overlap && sfx_offset_2 == 1+s2.size())){
+    if (i+sfx_offset_1 == len_first || (len_second >= min_bp_overlap && sfx_offset_2 == 1+len_second)){
       double frac = 1.0*(sfx_offset_1-k)/sfx_offset_1;
 
       // Check if stitching satisfies minimum fraction requirement
@@ -82,58 +210,75 @@ void ReadStitcher::kMismatch(const std::string& s1, const std::string& s2, int*
 	  if (k == 0)
 	    return;
 	}
-
-	/*
-	if (sfx_offset_1-k > *max_matches){
-	  *max_matches   = sfx_offset_1-k;
-	  *max_match_idx = i;
-	}
-	*/
       }
     }
   }
 }
 
-ReadInfo ReadStitcher::merge_read_information(ReadInfo& r1, ReadInfo& r2, int stitch_index, int num_bp_overlap, int num_mismatches){
-  std::string sequence = r1.get_sequence().substr(0, stitch_index);
-  std::string quality  = r1.get_quality().substr(0, stitch_index);
+/* Appends the decimal representation of value to s */
+static void append_int(std::string& s, int value){
+  char digits[16];
+  int num_digits = 0;
+  if (value < 0){
+    s += '-';
+    value = -value;
+  }
+  do {
+    digits[num_digits++] = '0' + value%10;
+    value /= 10;
+  } while (value != 0);
+  while (num_digits > 0)
+    s += digits[--num_digits];
+}
+
+void ReadStitcher::merge_read_information(ReadBatch& upstream, ReadBatch& downstream, size_t i, int stitch_index, int num_bp_overlap, int num_mismatches, ReadBatch& merged){
+  ProfileScope scope(profile_, STAGE_MERGE);
+  stitched_name_.assign("STITCHED_");
+  append_int(stitched_name_, num_bp_overlap);
+  stitched_name_ += '_';
+  append_int(stitched_name_, num_mismatches);
+  stitched_name_ += '_';
+  StringView name = upstream.name(i);
+  stitched_name_.append(name.data, name.size);
+
+  StringView s1 = upstream.sequence(i),   q1 = upstream.quality(i);
+  StringView s2 = downstream.sequence(i), q2 = downstream.quality(i);
+  int overlap   = std::min(s1.size-stitch_index, s2.size);
+  size_t index  = merged.add(stitched_name_.data(), stitched_name_.size(), NULL, NULL, stitch_index + std::max(s1.size-stitch_index, s2.size));
+  char* sequence = merged.mutable_sequence(index);
+  char* quality  = merged.mutable_quality(index);
 
   // Leading portion of stitched read
-  std::string s1 = r1.get_sequence().substr(stitch_index);
-  std::string s2 = r2.get_sequence();
-  std::string q1 = r1.get_quality().substr(stitch_index);
-  std::string q2 = r2.get_quality();
+  std::copy(s1.data, s1.data+stitch_index, sequence);
+  std::copy(q1.data, q1.data+stitch_index, quality);
 
   // For the overlapping portion of the reads, select the base
   // with the highest quality score
-  int i;
-  for (i = 0; i < std::min(q1.length(), q2.length()); i++){
-    if (q1[i] >= q2[i]){
-      sequence += s1[i];
-      quality  += q1[i];
+  int j;
+  for (j = 0; j < overlap; j++){
+    char b1 = s1[stitch_index+j], b2 = s2[j];
+    char c1 = q1[stitch_index+j], c2 = q2[j];
+    if (c1 >= c2){
+      sequence[stitch_index+j] = b1;
+      quality[stitch_index+j]  = c1;
     }
     else {
-      sequence += s2[i];
-      quality  += q2[i];
+      sequence[stitch_index+j] = b2;
+      quality[stitch_index+j]  = c2;
     }
 
-    if (s1[i] != s2[i])
-      mismatch_base_quals_[std::min(q1[i], q2[i])]++;
-    else
-      match_base_quals_[std::min(q1[i], q2[i])]++;
+    stats_.add_overlap_base(std::min(c1, c2), b1 == b2);
   }
 
   // Trailing portion of stitched read
-  if (i < q1.length()){
-    sequence += s1.substr(i);
-    quality  += q1.substr(i);
+  if (stitch_index+j < s1.size){
+    std::copy(s1.data+stitch_index+j, s1.data+s1.size, sequence+stitch_index+j);
+    std::copy(q1.data+stitch_index+j, q1.data+q1.size, quality+stitch_index+j);
   }
   else {
-    sequence += s2.substr(i);
-    quality  += q2.substr(i);
+    std::copy(s2.data+j, s2.data+s2.size, sequence+stitch_index+j);
+    std::copy(q2.data+j, q2.data+q2.size, quality+stitch_index+j);
   }
-
-  return ReadInfo("STITCHED_" + std::to_string(num_bp_overlap) + "_" + std::to_string(num_mismatches) + "_" + r1.get_identifier() , sequence, quality, false);
 }
 
 int ReadStitcher::stitch_reads(const std::string& s1, const std::string& s2, int& num_bp_overlap, int& num_mismatches){
@@ -147,120 +292,494 @@ int ReadStitcher::stitch_reads(const std::string& s1, const std::string& s2, int
     return -1;
 }
 
-void ReadStitcher::stitch_fastq(std::string fastq_f1, std::string fastq_f2, std::string output_prefix, std::ostream& log){
-  FASTQReader f1_reader(fastq_f1, true, false);
-  FASTQReader f2_reader(fastq_f2, true, true);
-  ReadInfo f1_read       = f1_reader.next_read();
-  ReadInfo f2_read       = f2_reader.next_read();
-  std::string prev_f1_id = f1_read.get_identifier();
-  std::string prev_f2_id = f2_read.get_identifier();
+StitchStatus ReadStitcher::stitch_pair(ReadPairBatch& batch, size_t i){
+  ReadBatch& f1_reads = batch.reads_1;
+  ReadBatch& f2_reads = batch.reads_2;
+
+  // Remove N's on ends of reads and low quality flanks
+  {
+    ProfileScope scope(profile_, STAGE_TRIM);
+    f1_reads.trimNTails(i);
+    f2_reads.trimNTails(i);
+    if (adapter_trimmer_ != NULL){
+      int adapter_1 = adapter_trimmer_->find(0, f1_reads.sequence(i));
+      int adapter_2 = adapter_trimmer_->find(1, f2_reads.sequence(i));
+      f1_reads.trimAdapter(i, adapter_1);
+      f2_reads.trimAdapter(i, adapter_2);
+      if (adapter_1 != 0)
+	stats_.add_adapter(0);
+      if (adapter_2 != 0)
+	stats_.add_adapter(1);
+    }
+    char min_qual = '5';
+    f1_reads.trimLowQualityEnds(i, min_qual);
+    f2_reads.trimLowQualityEnds(i, min_qual);
+  }
+  stats_.add_trim(0, f1_reads.trimmed(i));
+  stats_.add_trim(1, f2_reads.trimmed(i));
+  if (f1_reads.empty(i) || f2_reads.empty(i))
+    return TRIM_FAILED;
 
-  FASTQWriter f1_writer(output_prefix + "_1.fq.gz");
-  FASTQWriter f2_writer(output_prefix + "_2.fq.gz");
-  FASTQWriter stitched(output_prefix  + "_stitched.fq.gz");
-  int32_t N_skip_count = 0, length_skip_count = 0, success_count = 0, fail_count = 0;
+  // Attempt to stitch the reads together
+  int best_frac_idx;
+  double best_frac;
+  int num_bp_overlap, num_mismatches;
+
+  // Skip reads with N's, as the suffix tree doesn't accommodate it
+  StringView f1_seq = f1_reads.sequence(i), f2_seq = f2_reads.sequence(i);
+  {
+    ProfileScope scope(profile_, STAGE_N_SCAN);
+    if (memchr(f1_seq.data, 'N', f1_seq.size) != NULL || memchr(f2_seq.data, 'N', f2_seq.size) != NULL)
+      return N_SKIPPED;
+  }
+
+  // Offsets without a shared seed can't meet the requirements, so pairs without any candidates are never indexed
+  const char* candidates     = NULL;
+  const char* rev_candidates = NULL;
+  if (seed_filter_ != NULL){
+    ProfileScope scope(profile_, STAGE_SEED_FILTER);
+    if (seed_filter_->find_candidates(f1_seq, f2_seq) == 0){
+      search_stats_.pairs_rejected++;
+      return UNSTITCHED;
+    }
+    candidates     = seed_filter_->candidates(false);
+    rev_candidates = seed_filter_->candidates(true);
+  }
+
+  // Score both orientations from a single index, keeping the one with the better fraction of matching bases.
+  // Ties go to the orientation in which f1 is upstream
+  prepare_pair(f1_seq, f2_seq);
+  kMismatchOriented(false, candidates, &best_frac_idx, &best_frac, num_bp_overlap, num_mismatches);
+  if (best_frac == 1.0){
+    // Stitching met requirements and can't be beaten
+    merge_read_information(f1_reads, f2_reads, i, best_frac_idx, num_bp_overlap, num_mismatches, batch.stitched);
+    stats_.add_stitch(false, num_bp_overlap, num_mismatches);
+    return STITCHED;
+  }
+
+  // Retry stitching, reversing which read we assume comes upstream
+  int rev_best_frac_idx;
+  double rev_best_frac;
+  int rev_num_bp_overlap, rev_num_mismatches;
+  kMismatchOriented(true, rev_candidates, &rev_best_frac_idx, &rev_best_frac, rev_num_bp_overlap, rev_num_mismatches);
+  if (rev_best_frac_idx != -1 && (best_frac_idx == -1 || rev_best_frac > best_frac)){
+    // Stitching met requirements
+    //printStitching(f2_read.get_sequence(), f1_read.get_sequence(), rev_best_frac_idx);
+    merge_read_information(f2_reads, f1_reads, i, rev_best_frac_idx, rev_num_bp_overlap, rev_num_mismatches, batch.stitched);
+    stats_.add_stitch(true, rev_num_bp_overlap, rev_num_mismatches);
+    return STITCHED;
+  }
+  if (best_frac_idx != -1){
+    // Stitching met requirements
+    //printStitching(f1_read.get_sequence(), f2_read.get_sequence(), best_frac_idx);
+    merge_read_information(f1_reads, f2_reads, i, best_frac_idx, num_bp_overlap, num_mismatches, batch.stitched);
+    stats_.add_stitch(false, num_bp_overlap, num_mismatches);
+    return STITCHED;
+  }
+
+  // Stitching did not meet requirements
+  return UNSTITCHED;
+}
 
-  while (true){
+bool ReadStitcher::read_batch(FASTQReader& f1_reader, FASTQReader& f2_reader, ReadPairBatch& batch){
+  batch.clear();
+  while (batch.size() < BATCH_SIZE && pairs_left_ != 0){
     if (f1_reader.is_empty())
       break;
     if (f2_reader.is_empty())
       break;
 
-    f1_read = f1_reader.next_read();
-    f2_read = f2_reader.next_read();
-    if (f1_read.get_identifier().compare(f2_read.get_identifier()) != 0){
+    // The readers are the same object for interleaved input
+    f1_reader.next_read(batch.reads_1, false);
+    if (&f1_reader == &f2_reader && f2_reader.is_empty())
+      printErrorAndDie("Interleaved FASTQ file contains an odd number of records");
+    f2_reader.next_read(batch.reads_2, true);
+    size_t i = batch.size()-1;
+    StringView f1_name = batch.reads_1.name(i), f2_name = batch.reads_2.name(i);
+    if (f1_name.size != f2_name.size || memcmp(f1_name.data, f2_name.data, f1_name.size) != 0){
       std::stringstream error;
       error << "Mismatched read ids in FASTQ files:" << "\n"
-	    << "\t" << f1_read.get_identifier() << " and " << f2_read.get_identifier();
+	    << "\t" << std::string(f1_name.data, f1_name.size) << " and " << std::string(f2_name.data, f2_name.size);
       printErrorAndDie(error.str());
     }
+    if (pairs_left_ > 0)
+      pairs_left_--;
+  }
+  batch.end_1      = f1_reader.position();
+  batch.end_2      = f2_reader.position();
+  batch.pairs_left = pairs_left_;
+  return batch.size() != 0;
+}
 
-    // Remove N's on ends of reads and low quality flanks
-    f1_read.trimNTails();
-    f2_read.trimNTails();
-    char min_qual = '5';
-    f1_read.trimLowQualityEnds(min_qual);
-    f2_read.trimLowQualityEnds(min_qual);
-    if (f1_read.empty() || f2_read.empty()){
-      fail_count++;
-      continue;
-    }
+void ReadStitcher::process_batch(ReadPairBatch& batch){
+  for (size_t i = 0; i < batch.size(); i++){
+    batch.status.push_back(stitch_pair(batch, i));
+    stats_.add_status(batch.status.back());
+  }
+}
 
-    // Skip reads that exceed the max length, as they'll break the LCA computation
-    if (f1_read.get_sequence().size() > max_read_len || f2_read.get_sequence().size() > max_read_len){
-      f1_writer.write_read(f1_read);
-      f2_writer.write_read(f2_read);
-      length_skip_count++;
-      continue;
+// Comments that identify the records of the interleaved output stream. SAM-style tags let aligners copy them into their output
+static const char* STITCHED_TAG   = "ZS:Z:stitched";
+static const char* UNSTITCHED_TAG = "ZS:Z:unstitched";
+
+static void write_batch(ReadPairBatch& batch, FASTQWriter& f1_writer, FASTQWriter& f2_writer, FASTQWriter& stitched, bool tag, StageProfile* profile){
+  ProfileScope scope(profile, STAGE_WRITE);
+  size_t stitch_index = 0;
+  for (size_t i = 0; i < batch.size(); i++){
+    switch (batch.status[i]){
+    case STITCHED:
+      stitched.write_read(batch.stitched, stitch_index++, (tag ? STITCHED_TAG : NULL));
+      break;
+    case UNSTITCHED:
+      f1_writer.write_read(batch.reads_1, i, (tag ? UNSTITCHED_TAG : NULL));
+      f2_writer.write_read(batch.reads_2, i, (tag ? UNSTITCHED_TAG : NULL));
+      break;
+    default:
+      break;
     }
+  }
+}
 
-    // Attempt to stitch the reads together
-    int best_frac_idx;
-    double best_frac;
-    int num_bp_overlap, num_mismatches;
+void ReadStitcher::stitch_fastq(std::string fastq_f1, std::string fastq_f2, std::string output_prefix, int num_threads, int io_threads,
+				int compression_level, std::ostream& log){
+  bool interleaved_input  = fastq_f2.empty();
+  bool interleaved_output = (output_prefix.compare("-") == 0);
+  FASTQReader* f1_input = new FASTQReader(fastq_f1, true);
+  FASTQReader* f2_input = (interleaved_input ? f1_input : new FASTQReader(fastq_f2, true));
+  FASTQReader& f1_reader = *f1_input;
+  FASTQReader& f2_reader = *f2_input;
+  // The readers and the writers run on different threads in the pipeline, so each gets its own profile
+  StageProfile reader_profile(profile_counters_), writer_profile(profile_counters_);
+  StageProfile* reader_prof = (profile_ != NULL ? &reader_profile : NULL);
+  StageProfile* writer_prof = (profile_ != NULL ? &writer_profile : NULL);
+  f1_reader.set_profile(reader_prof);
+  f2_reader.set_profile(reader_prof);
+  // Each input and output gets its own BGZF threads, so (de)compression overlaps with stitching
+  f1_reader.set_io_threads(io_threads);
+  if (!interleaved_input)
+    f2_reader.set_io_threads(io_threads);
+
+  // Checkpoints need inputs that can be seeked and outputs that can be truncated
+  bool checkpoints = (checkpoint_interval_ > 0 && !interleaved_output && fastq_f1.compare("-") != 0 && fastq_f2.compare("-") != 0);
+  std::string checkpoint_path = output_prefix + ".checkpoint";
+  std::stringstream settings;
+  settings << fastq_f1 << "\t" << fastq_f2 << "\t" << shard_ << "/" << num_shards_ << "\t" << max_k << "\t" << min_bp_overlap << "\t" << min_frac_correct
+	   << "\t" << adapters_[0] << "\t" << adapters_[1] << "\t" << (infer_adapters_ ? "infer" : "given")
+	   << "\t" << compression_level;
+  Checkpoint checkpoint;
+  if (!interleaved_output){
+    checkpoint.outputs.push_back(output_prefix + "_1.fq.gz");
+    checkpoint.outputs.push_back(output_prefix + "_2.fq.gz");
+    checkpoint.outputs.push_back(output_prefix + "_stitched.fq.gz");
+  }
 
-    // Skip reads with N's, as the suffix tree doesn't accommodate it
-    if (f1_read.get_sequence().find("N") != std::string::npos ||
-	f2_read.get_sequence().find("N") != std::string::npos){
-      N_skip_count++;
-      continue;
+  pairs_left_ = -1;
+  if (resume_){
+    if (!checkpoints)
+      printErrorAndDie("Can't resume, as checkpoints aren't written for stdin or stdout or with a checkpoint interval of 0");
+    if (!checkpoint.read(checkpoint_path))
+      printErrorAndDie("Can't resume, as there's no checkpoint file " + checkpoint_path);
+    if (checkpoint.settings.compare(settings.str()) != 0)
+      printErrorAndDie("Can't resume, as checkpoint file " + checkpoint_path + " was written for different inputs or options");
+    if (checkpoint.outputs.size() != 3)
+      printErrorAndDie("Can't resume, as checkpoint file " + checkpoint_path + " doesn't list the three outputs");
+
+    // Anything written after the checkpoint is discarded and rewritten
+    for (size_t i = 0; i < checkpoint.outputs.size(); i++){
+      struct stat info;
+      if (stat(checkpoint.outputs[i].c_str(), &info) != 0 || info.st_size < checkpoint.output_sizes[i])
+	printErrorAndDie("Can't resume, as output file " + checkpoint.outputs[i] + " is missing or shorter than at the checkpoint");
+      if (truncate(checkpoint.outputs[i].c_str(), checkpoint.output_sizes[i]) != 0)
+	printErrorAndDie("Failed to truncate output file " + checkpoint.outputs[i]);
+    }
+    f1_reader.seek(checkpoint.f1_position);
+    if (!interleaved_input)
+      f2_reader.seek(checkpoint.f2_position);
+    pairs_left_   = checkpoint.pairs_left;
+    // Inferred adapters are restored rather than inferred again from different pairs
+    if (infer_adapters_)
+      set_adapters(checkpoint.adapters[0], checkpoint.adapters[1], false);
+    stats_        = checkpoint.stats;
+    search_stats_ = checkpoint.search_stats;
+    int64_t num_pairs = 0;
+    for (int i = 0; i < NUM_STITCH_STATUSES; i++)
+      num_pairs += stats_.status[i];
+    log << "Resuming from checkpoint file " << checkpoint_path << " after " << num_pairs << " pairs" << std::endl;
+  }
+  else {
+    // A checkpoint from an earlier run no longer matches the outputs, which are about to be overwritten
+    if (checkpoints)
+      remove(checkpoint_path.c_str());
+
+    // A shard seeks both readers to its first pair and stops after its last one
+    int64_t first_pair = 0;
+    if (num_shards_ > 1){
+      ShardIndex f1_index(fastq_f1, log);
+      ShardRange range = f1_index.shard_range(shard_, num_shards_);
+      int64_t records_per_pair = 1;
+      if (interleaved_input)
+	records_per_pair = 2;
+      else {
+	ShardIndex f2_index(fastq_f2, log);
+	if (f1_index.num_records() != f2_index.num_records()){
+	  std::stringstream error;
+	  error << "FASTQ files contain different numbers of records (" << f1_index.num_records() << " and " << f2_index.num_records() << ")";
+	  printErrorAndDie(error.str());
+	}
+	ShardRange range_2 = f2_index.shard_range(shard_, num_shards_);
+	if (range_2.num_records != 0)
+	  f2_reader.seek(range_2.offset);
+      }
+      if (range.num_records != 0)
+	f1_reader.seek(range.offset);
+      first_pair  = range.first_record/records_per_pair;
+      pairs_left_ = (range.num_records < 0 ? -1 : range.num_records/records_per_pair);
+      log << "Shard " << shard_+1 << "/" << num_shards_ << " starts at pair " << first_pair << " and contains ";
+      if (pairs_left_ < 0)
+	log << "the remaining pairs" << std::endl;
+      else
+	log << pairs_left_ << " pairs" << std::endl;
     }
 
-    kMismatch(f1_read.get_sequence(), f2_read.get_sequence(), &best_frac_idx, &best_frac, num_bp_overlap, num_mismatches);
-    if (best_frac_idx != -1){
-      // Stitching met requirements
-      //std::cout << num_bp_overlap << " " << num_mismatches << std::endl;
-      //printStitching(f1_read.get_sequence(), f2_read.get_sequence(), best_frac_idx);
-      ReadInfo stitched_read = merge_read_information(f1_read, f2_read, best_frac_idx, num_bp_overlap, num_mismatches);
-      stitched.write_read(stitched_read);
-      success_count++;
+    // The first pair in the files is consumed here and is never stitched or written
+    if (first_pair == 0 && pairs_left_ != 0){
+      FASTQRecord discarded;
+      f1_reader.next_record(discarded, false);
+      f2_reader.next_record(discarded, false);
+      if (pairs_left_ > 0)
+	pairs_left_--;
     }
-    else {
-      // Retry stitching, reversing which read we assume comes upstream
-      kMismatch(f2_read.get_sequence(), f1_read.get_sequence(), &best_frac_idx, &best_frac, num_bp_overlap, num_mismatches);
-      if (best_frac_idx != -1){
-	// Stitching met requirements
-	//printStitching(f2_read.get_sequence(), f1_read.get_sequence(), best_frac_idx);
-	ReadInfo stitched_read = merge_read_information(f2_read, f1_read, best_frac_idx, num_bp_overlap, num_mismatches);
-	stitched.write_read(stitched_read);
-	success_count++;
-      }
-      else {
-	// Stitching did not meet requirements
-	f1_writer.write_read(f1_read);
-	f2_writer.write_read(f2_read);
-	fail_count++;
+  }
+
+  // Adapters are inferred from the first batches, which are then stitched like any others
+  std::vector<ReadPairBatch> prefetched;
+  size_t num_prefetched = 0;
+  if (infer_adapters_ && !resume_){
+    AdapterInference inference;
+    ReadPairBatch batch;
+    while (prefetched.size() < INFER_BATCHES && read_batch(f1_reader, f2_reader, batch)){
+      for (size_t i = 0; i < batch.size(); i++)
+	inference.add_pair(batch.reads_1.sequence(i), batch.reads_2.sequence(i));
+      prefetched.push_back(batch);
+    }
+    std::string adapter_1 = (adapters_[0].empty() ? inference.adapter(0) : adapters_[0]);
+    std::string adapter_2 = (adapters_[1].empty() ? inference.adapter(1) : adapters_[1]);
+    log << "Found " << inference.num_pairs() << " read-through pairs. Adapters: "
+	<< (adapter_1.empty() ? "none" : adapter_1) << " and " << (adapter_2.empty() ? "none" : adapter_2) << std::endl;
+    set_adapters(adapter_1, adapter_2, false);
+  }
+  auto next_batch = [&](ReadPairBatch& batch){
+    if (num_prefetched < prefetched.size()){
+      std::swap(batch, prefetched[num_prefetched++]);
+      return true;
+    }
+    return read_batch(f1_reader, f2_reader, batch);
+  };
+  checkpoint.adapters[0] = adapters_[0];
+  checkpoint.adapters[1] = adapters_[1];
+
+  // All three outputs share a single uncompressed stream on stdout when the output is interleaved
+  FASTQWriter* f1_output;
+  FASTQWriter* f2_output;
+  FASTQWriter* stitched_output;
+  if (interleaved_output)
+    f1_output = f2_output = stitched_output = new FASTQWriter("-", FASTQWriter::UNCOMPRESSED, 0, false);
+  else {
+    f1_output       = new FASTQWriter(checkpoint.outputs[0], compression_level, io_threads, resume_);
+    f2_output       = new FASTQWriter(checkpoint.outputs[1], compression_level, io_threads, resume_);
+    stitched_output = new FASTQWriter(checkpoint.outputs[2], compression_level, io_threads, resume_);
+  }
+  FASTQWriter& f1_writer = *f1_output;
+  FASTQWriter& f2_writer = *f2_output;
+  FASTQWriter& stitched  = *stitched_output;
+
+  std::chrono::steady_clock::time_point last_checkpoint = std::chrono::steady_clock::now();
+  auto checkpoint_due = [&](){
+    if (!checkpoints)
+      return false;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - last_checkpoint).count() < checkpoint_interval_)
+      return false;
+    last_checkpoint = now;
+    return true;
+  };
+  // Records everything up to the end of batch. The statistics are this stitcher's plus those of the pipeline's workers
+  auto save_checkpoint = [&](const ReadPairBatch& batch, const std::vector<ReadStitcher*>& workers){
+    ProfileScope scope(writer_prof, STAGE_WRITE);
+    checkpoint.settings    = settings.str();
+    checkpoint.f1_position = batch.end_1;
+    checkpoint.f2_position = batch.end_2;
+    checkpoint.pairs_left  = batch.pairs_left;
+    checkpoint.output_sizes.clear();
+    checkpoint.output_sizes.push_back(f1_writer.sync());
+    checkpoint.output_sizes.push_back(f2_writer.sync());
+    checkpoint.output_sizes.push_back(stitched.sync());
+    checkpoint.stats        = stats_;
+    checkpoint.search_stats = search_stats_;
+    for (size_t i = 0; i < workers.size(); i++){
+      checkpoint.stats.merge(workers[i]->stats_);
+      checkpoint.search_stats.merge(workers[i]->search_stats_);
+    }
+    checkpoint.write(checkpoint_path);
+  };
+
+  if (num_threads <= 1){
+    ReadPairBatch batch;
+    std::vector<ReadStitcher*> no_workers;
+    while (next_batch(batch)){
+      process_batch(batch);
+      write_batch(batch, f1_writer, f2_writer, stitched, interleaved_output, writer_prof);
+      if (checkpoint_due())
+	save_checkpoint(batch, no_workers);
+    }
+  }
+  else {
+    // Pipeline: a reader thread fills batches, num_threads workers stitch them using their own
+    // ReadStitcher (and therefore their own LCA and statistics) and this thread writes the results
+    // in input order. Batches are recycled through a fixed-size pool, bounding the memory in flight
+    std::vector<ReadPairBatch> pool(2*num_threads + 2);
+    WorkQueue<ReadPairBatch*> free_batches, full_batches, done_batches;
+    WorkQueue<bool> checkpoints_written;
+    for (size_t i = 0; i < pool.size(); i++)
+      free_batches.push(&pool[i]);
+
+    std::thread reader([&](){
+	ReadPairBatch* batch;
+	int64_t index = 0;
+	bool written;
+	while (free_batches.pop(batch)){
+	  if (!next_batch(*batch))
+	    break;
+	  bool due = checkpoint_due();
+	  batch->index      = index++;
+	  batch->checkpoint = due;
+	  full_batches.push(batch);
+	  // Nothing past a checkpoint is read until it's written, so the workers' statistics cover exactly the written pairs
+	  if (due)
+	    checkpoints_written.pop(written);
+	}
+	full_batches.close();
+      });
+    std::vector<ReadStitcher*> stitchers;
+    std::vector<std::thread> workers;
+    std::atomic<int> active_workers(num_threads);
+    for (int i = 0; i < num_threads; i++){
+      stitchers.push_back(new ReadStitcher(max_read_len, max_k, min_bp_overlap, min_frac_correct, seed_length, engine, lca_method));
+      if (profile_ != NULL)
+	stitchers.back()->enable_profiling(profile_counters_);
+      stitchers.back()->set_adapters(adapters_[0], adapters_[1], false);
+    }
+    for (int i = 0; i < num_threads; i++){
+      ReadStitcher* worker = stitchers[i];
+      workers.push_back(std::thread([&, worker](){
+	    ReadPairBatch* batch;
+	    while (full_batches.pop(batch)){
+	      worker->process_batch(*batch);
+	      done_batches.push(batch);
+	    }
+	    if (--active_workers == 0)
+	      done_batches.close();
+	  }));
+    }
+
+    std::map<int64_t, ReadPairBatch*> pending;
+    int64_t next_index = 0;
+    ReadPairBatch* batch;
+    while (done_batches.pop(batch)){
+      pending[batch->index] = batch;
+      while (!pending.empty() && pending.begin()->first == next_index){
+	ReadPairBatch* next = pending.begin()->second;
+	write_batch(*next, f1_writer, f2_writer, stitched, interleaved_output, writer_prof);
+	if (next->checkpoint){
+	  save_checkpoint(*next, stitchers);
+	  checkpoints_written.push(true);
+	}
+	free_batches.push(next);
+	pending.erase(pending.begin());
+	next_index++;
       }
     }
+    free_batches.close();
+
+    reader.join();
+    for (int i = 0; i < num_threads; i++){
+      workers[i].join();
+      merge_stats(*stitchers[i]);
+      delete stitchers[i];
+    }
   }
 
-  if (length_skip_count != 0)
-    log << "Skipped " << length_skip_count << " reads whose length was greater than " << max_read_len << "\n"
-	      << "\t" << "If this is a significant fraction of your dataset, consider increasing --max-read-length" << std::endl;
+  int64_t N_skip_count  = stats_.status[N_SKIPPED];
+  int64_t success_count = stats_.status[STITCHED];
+  int64_t fail_count    = stats_.status[UNSTITCHED] + stats_.status[TRIM_FAILED];
   if (N_skip_count != 0)
     log << "Skipped " << N_skip_count << " reads with N bases" << std::endl;
+  if (adapter_trimmer_ != NULL)
+    log << "Trimmed adapters from " << stats_.adapters[0] << " first reads and " << stats_.adapters[1] << " second reads" << std::endl;
   log << "Stitching succeeded for " << success_count << " out of " << (success_count+fail_count) << " remaining pairs of reads (" << (100.0*success_count/(success_count+fail_count)) << "%)" << std::endl;
+  if (seed_filter_ != NULL)
+    log << "Seed filter rejected " << search_stats_.pairs_rejected << " pairs without any candidate offsets" << std::endl;
+  log << "Overlap search filtered " << search_stats_.offsets_filtered << ", pruned " << search_stats_.offsets_skipped
+      << " and aborted " << search_stats_.walks_aborted << " out of " << search_stats_.offsets << " offsets" << std::endl;
 
   f1_reader.close();
   f2_reader.close();
-  f1_writer.close();
-  f2_writer.close();
-  stitched.close();
+  if (!interleaved_input)
+    delete f2_input;
+  delete f1_input;
+  {
+    // Closing a writer is a no-op after the first time, so the shared interleaved writer is only flushed once
+    ProfileScope scope(writer_prof, STAGE_WRITE);
+    f1_writer.close();
+    f2_writer.close();
+    stitched.close();
+  }
+  if (!interleaved_output){
+    delete f2_output;
+    delete stitched_output;
+  }
+  delete f1_output;
+  // The outputs are complete, so there's nothing left to resume
+  if (checkpoints)
+    remove(checkpoint_path.c_str());
+
+  if (profile_ != NULL){
+    profile_->merge(reader_profile);
+    profile_->merge(writer_profile);
+    profile_->print(log);
+  }
 }
 
+void ReadStitcher::merge_stats(const ReadStitcher& other){
+  stats_.merge(other.stats_);
+  search_stats_.merge(other.search_stats_);
+  if (profile_ != NULL && other.profile_ != NULL)
+    profile_->merge(*other.profile_);
+}
 
-void ReadStitcher::print_base_qual_stats(std::ostream& out){
-  int64_t match_total = 0;
-  for (auto count_iter = match_base_quals_.begin(); count_iter != match_base_quals_.end(); count_iter++)
-      match_total += count_iter->second;
-  for (auto count_iter = match_base_quals_.begin(); count_iter != match_base_quals_.end(); count_iter++)
-    out << count_iter->first << "\t" << count_iter->second << "\t" << 100.0*count_iter->second/match_total << "\n";
+/* Prints the count and percentage of each quality score with a non-zero count */
+static void print_qual_table(const int64_t* counts, std::ostream& out){
+  int64_t total = 0;
+  for (int i = 0; i < 256; i++)
+    total += counts[i];
+  for (int i = 0; i < 256; i++)
+    if (counts[i] != 0)
+      out << (char)i << "\t" << counts[i] << "\t" << 100.0*counts[i]/total << "\n";
   out << "\n";
+}
 
-  int64_t mismatch_total = 0;
-  for (auto count_iter = mismatch_base_quals_.begin(); count_iter != mismatch_base_quals_.end(); count_iter++)
-    mismatch_total += count_iter->second;
-  for (auto count_iter = mismatch_base_quals_.begin(); count_iter != mismatch_base_quals_.end(); count_iter++)
-    out << count_iter->first << "\t" << count_iter->second << "\t" << 100.0*count_iter->second/mismatch_total << "\n";
-  out << "\n";
+void ReadStitcher::print_base_qual_stats(std::ostream& out){
+  print_qual_table(stats_.match_quals,    out);
+  print_qual_table(stats_.mismatch_quals, out);
+}
+
+void ReadStitcher::write_stats(std::string path){
+  std::ofstream out(path.c_str());
+  if (!out.is_open())
+    printErrorAndDie("Failed to open the statistics file " + path);
+  if (string_ends_with(path, ".json"))
+    stats_.write_json(out, search_stats_);
+  else
+    stats_.write_tsv(out, search_stats_);
+  out.close();
 }
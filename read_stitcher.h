@@ -2,34 +2,131 @@
 #define READ_STITCHER_H
 
 #include <iostream>
-#include <map>
 #include <string>
+#include <vector>
 
-#include "read_info.h"
-#include "lca.h"
+#include "adapter_trimmer.h"
+#include "fastq_reader.h"
+#include "fastq_writer.h"
+#include "bitparallel_matcher.h"
+#include "lca_backend.h"
+#include "read_batch.h"
+#include "lce_index.h"
+#include "profiler.h"
+#include "search_stats.h"
+#include "seed_filter.h"
+#include "stitch_stats.h"
+
+// Method used to find the best overlap between a pair of reads
+enum StitchEngine {
+  SUFFIX_TREE_ENGINE,  // Longest common extension queries on a suffix tree of both reads
+  SUFFIX_ARRAY_ENGINE, // Longest common extension queries on a suffix array and LCP array of both reads
+  BITPARALLEL_ENGINE   // Direct comparison of 2-bit packed reads at every offset
+};
+
+// Group of consecutive read pairs that moves through the reader, stitching and writer stages as a unit.
+// Batches are recycled, so their arenas are reused rather than reallocated for every group of reads
+class ReadPairBatch {
+public:
+  int64_t index;                      // Position of the batch in the input, used to restore the output order
+  ReadBatch reads_1;
+  ReadBatch reads_2;
+  std::vector<StitchStatus> status;   // One entry per pair
+  ReadBatch stitched;                 // One read per STITCHED pair, in input order
+  ReaderPosition end_1, end_2;        // Positions of the readers after the batch's last pair
+  int64_t pairs_left;                 // Pairs the shard still had to read after the batch
+  bool checkpoint;                    // Whether a checkpoint is written once the batch has been
+
+  ReadPairBatch(){ index = 0; pairs_left = -1; checkpoint = false; }
+
+  void clear(){
+    reads_1.clear();
+    reads_2.clear();
+    status.clear();
+    stitched.clear();
+  }
+
+  size_t size(){ return reads_1.size(); }
+};
 
 class ReadStitcher {
 private:
-  int    max_read_len;
+  int    max_read_len;       // Expected read length, used to size the initial LCA tables
   int    max_k;
   int    min_bp_overlap;
   double min_frac_correct;
-  LCA *  lca;
+  int    seed_length;        // Length of the exact seeds used to filter offsets. 0 disables the filter
+  StitchEngine engine;
+  LCAMethod lca_method;
+  LCEIndex*   lce_;      // Index for the suffix tree and suffix array engines. Rebuilt for each pair of reads
+  std::string joined_;   // Concatenated sequences the index is built from
+  BitParallelMatcher bitparallel_;
+  int len_1_, len_2_;    // Lengths of the reads passed to prepare_pair()
+  SeedFilter* seed_filter_;
+  std::string stitched_name_;  // Scratch space for the identifiers of stitched reads
 
-  std::map<char, int64_t> match_base_quals_;
-  std::map<char, int64_t> mismatch_base_quals_;
+  StitchStats stats_;
+  SearchStats search_stats_;
+  StageProfile* profile_;      // Per-stage costs if profiling is enabled, NULL otherwise
+  bool profile_counters_;      // Whether the profile includes hardware counters
+  int shard_, num_shards_;     // Slice of the input that stitch_fastq() processes
+  int64_t pairs_left_;         // Pairs read_batch() may still read, or -1 if it reads to the end of the input
+  double checkpoint_interval_; // Seconds between checkpoints, or 0 if they're disabled
+  bool resume_;
+  std::string adapters_[2];    // Adapters trimmed from each read, as sequenced
+  bool infer_adapters_;        // Whether stitch_fastq() infers the adapters that weren't given
+  AdapterTrimmer* adapter_trimmer_;  // NULL if there are no adapters to trim
+
+  const static size_t BATCH_SIZE = 4096;
+  const static size_t INFER_BATCHES = 10;   // Batches read ahead to infer adapters from
+
+  // Builds the engine's index for a pair of reads. Both orientations can then be scored with kMismatchOriented()
+  void prepare_pair(const StringView& s1, const StringView& s2);
+  // Same as kMismatch, but for the prepared pair. If reverse is true, s2 is assumed to be upstream of s1.
+  // If candidates is not NULL, only the offsets it flags are verified
+  void kMismatchOriented(bool reverse, const char* candidates, int* best_frac_idx, double* best_frac, int& num_bp_overlap, int& num_mismatches);
 
   void printStitching(const std::string& s1, const std::string& s2, int index);
-  ReadInfo merge_read_information(ReadInfo& r1, ReadInfo& r2, int stitch_index, int num_bp_overlap, int num_mismatches);
+
+  bool read_batch(FASTQReader& f1_reader, FASTQReader& f2_reader, ReadPairBatch& batch);
+  void process_batch(ReadPairBatch& batch);
+  void merge_stats(const ReadStitcher& other);
 
 public:
-  ReadStitcher(int max_read_len, int max_k, int min_bp_overlap, double min_frac_correct);
+  ReadStitcher(int max_read_len, int max_k, int min_bp_overlap, double min_frac_correct, int seed_length, StitchEngine engine, LCAMethod lca_method);
   ~ReadStitcher();
 
+  // Times each stage of stitching, optionally with hardware counters. stitch_fastq() writes the results to its log
+  void enable_profiling(bool hardware_counters);
+
+  // Restricts stitch_fastq() to the shard-th of num_shards slices of the input, numbering shards from 0. The slices are
+  // record-aligned and the same for both files, and the outputs of all shards concatenate into those of a single run
+  void set_shard(int shard, int num_shards);
+
+  // Removes adapter_1 and adapter_2 and anything after them from the 3' ends of the first and second reads, before
+  // low quality ends are trimmed. Empty adapters aren't trimmed, or are inferred from read-through pairs at the start
+  // of stitch_fastq() if infer is true
+  void set_adapters(const std::string& adapter_1, const std::string& adapter_2, bool infer);
+
+  // Writes a checkpoint to <output_prefix>.checkpoint every interval seconds during stitch_fastq(), or never if interval
+  // is 0. If resume is true, stitch_fastq() continues from the last checkpoint rather than starting over. Inputs and
+  // outputs on stdin or stdout can't be checkpointed
+  void set_checkpoints(double interval, bool resume);
+
   int stitch_reads(const std::string& s1, const std::string& s2, int& num_bp_overlap, int& num_mismatches);
-  void stitch_fastq(std::string fastq_f1, std::string fastq_f2, std::string output_prefix, std::ostream& log);
+  // Trims and stitches the batch's i-th pair of reads. If they're STITCHED, the merged read is appended to batch.stitched
+  StitchStatus stitch_pair(ReadPairBatch& batch, size_t i);
+  // Merges the i-th reads of the upstream and downstream batches and appends the result to merged
+  void merge_read_information(ReadBatch& upstream, ReadBatch& downstream, size_t i, int stitch_index, int num_bp_overlap, int num_mismatches, ReadBatch& merged);
+  // If fastq_f2 is empty, fastq_f1 holds both reads of each pair in consecutive records. If output_prefix is "-",
+  // stitched reads and unstitched pairs are written to stdout as one uncompressed, interleaved FASTQ stream whose
+  // records are tagged ZS:Z:stitched or ZS:Z:unstitched
+  void stitch_fastq(std::string fastq_f1, std::string fastq_f2, std::string output_prefix, int num_threads, int io_threads,
+		    int compression_level, std::ostream& log);
   void kMismatch(const std::string& s1, const std::string& s2, int* best_frac_idx, double* best_frac, int& num_bp_overlap, int& num_mismatches);
   void print_base_qual_stats(std::ostream& out);
+  // Writes the statistics of the last call to stitch_fastq() to path, as JSON if it ends in .json and as TSV otherwise
+  void write_stats(std::string path);
 };
 
 #endif
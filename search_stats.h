@@ -0,0 +1,49 @@
+#ifndef SEARCH_STATS_H
+#define SEARCH_STATS_H
+
+#include <stdint.h>
+
+/*
+ * Work avoided by the seed filter and the pruning in the k-mismatch overlap search. Offsets are pruned using an upper bound on the
+ * fraction of correct bases they could achieve, which can never exceed (overlap - mismatches)/overlap for the
+ * mismatches that are already known. Pruning only discards offsets that could not have replaced the best result,
+ * so it never changes the outcome of the search
+ */
+class SearchStats {
+ public:
+  int64_t pairs_rejected;   // Pairs without a single candidate offset, which were never scored
+  int64_t offsets;          // Offsets in the search ranges of all of the scored orientations
+  int64_t offsets_filtered; // Offsets without a shared seed, ruled out by the seed filter
+  int64_t offsets_skipped;  // Offsets ruled out before any bases were compared
+  int64_t walks_aborted;    // Offsets whose comparison stopped once it could no longer beat the best result
+
+  SearchStats(){ pairs_rejected = offsets = offsets_filtered = offsets_skipped = walks_aborted = 0; }
+
+  void merge(const SearchStats& other){
+    pairs_rejected   += other.pairs_rejected;
+    offsets          += other.offsets;
+    offsets_filtered += other.offsets_filtered;
+    offsets_skipped  += other.offsets_skipped;
+    walks_aborted    += other.walks_aborted;
+  }
+};
+
+/*
+ * Returns the largest number of mismatches m for which an overlap of the given length has a fraction of
+ * correct bases, 1.0*(overlap-m)/overlap, greater than threshold. Returns -1 if no number of mismatches does.
+ * Uses the same floating point expression as the search, so the bound is exact
+ */
+inline int max_mismatches_above(int overlap, double threshold){
+  int m = (int)(overlap*(1.0-threshold));
+  if (m > overlap)
+    m = overlap;
+  if (m < -1)
+    m = -1;
+  while (m >= 0 && !(1.0*(overlap-m)/overlap > threshold))
+    m--;
+  while (m < overlap && 1.0*(overlap-m-1)/overlap > threshold)
+    m++;
+  return m;
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#include "bitparallel_matcher.h"
+#include "search_stats.h"
+#include "seed_filter.h"
+
+SeedFilter::SeedFilter(int seed_length, int max_k, int min_bp_overlap, double min_frac_correct){
+  this->seed_length      = seed_length;
+  this->max_k            = max_k;
+  this->min_bp_overlap   = min_bp_overlap;
+  this->min_frac_correct = min_frac_correct;
+}
+
+void SeedFilter::encode(const StringView& s, std::vector<uint32_t>& codes){
+  codes.clear();
+  if (s.size < seed_length)
+    return;
+
+  uint32_t mask = (seed_length == 16 ? 0xFFFFFFFFU : (1U << (2*seed_length)) - 1);
+  uint32_t val  = 0;
+  for (int i = 0; i < s.size; i++){
+    val = ((val << 2) | base_code(s[i])) & mask;
+    if (i >= seed_length-1)
+      codes.push_back(val);
+  }
+}
+
+int SeedFilter::mark_candidates(const StringView& first, const StringView& second, std::vector<char>& candidates){
+  int len_first = first.size, len_second = second.size;
+  while ((int)budgets_.size() <= std::max(len_first, len_second)+1)
+    budgets_.push_back(std::min(max_k, max_mismatches_above(budgets_.size(), min_frac_correct)));
+
+  // The end of the second read counts as an additional mismatch in an overlap of len_second+1
+  int overhang_budget = (len_second >= min_bp_overlap ? std::min(max_k-1, budgets_[len_second+1]-1) : -1);
+
+  int num_candidates = 0;
+  for (int i = 0; i < (int)candidates.size(); i++){
+    // Length of the compared region and the most mismatches it can contain, following the acceptance rules of kMismatch
+    int length, budget;
+    if (len_first - i <= len_second){
+      length = len_first - i;
+      budget = budgets_[length];
+    }
+    else {
+      length = len_second;
+      budget = overhang_budget;
+    }
+
+    if (budget < 0)
+      candidates[i] = 0;
+    else if (length/(budget+1) < seed_length){
+      // Too many mismatches are allowed for an exact seed to be guaranteed. Short regions, which are
+      // typically the smallest overlaps, are cheap enough to compare directly instead
+      if (length <= MAX_DIRECT_LENGTH){
+	int mismatches = 0;
+	for (int j = 0; j < length && mismatches <= budget; j++)
+	  mismatches += (first[i+j] != second[j]);
+	candidates[i] = (mismatches <= budget);
+      }
+      else
+	candidates[i] = 1;
+    }
+    num_candidates += candidates[i];
+  }
+  return num_candidates;
+}
+
+int SeedFilter::find_candidates(const StringView& s1, const StringView& s2){
+  int len_1 = s1.size, len_2 = s2.size;
+  forward_.assign(std::max(0, len_1 - min_bp_overlap), 0);
+  reverse_.assign(std::max(0, len_2 - min_bp_overlap), 0);
+
+  encode(s1, codes_1);
+  encode(s2, codes_2);
+  if (!codes_1.empty() && !codes_2.empty()){
+    int bits = 6;
+    while ((1 << bits) < 2*(int)codes_2.size())
+      bits++;
+    slots_.assign(1 << bits, -1);
+    chain_.resize(codes_2.size());
+    for (int p = 0; p < (int)codes_2.size(); p++){
+      uint32_t slot = (codes_2[p]*2654435761U) >> (32-bits);
+      chain_[p]    = slots_[slot];
+      slots_[slot] = p;
+    }
+
+    // A seed at s1[j] and s2[p] lies on offset j-p when s1 is upstream and on offset p-j when s2 is upstream
+    for (int j = 0; j < (int)codes_1.size(); j++){
+      uint32_t slot = (codes_1[j]*2654435761U) >> (32-bits);
+      for (int p = slots_[slot]; p != -1; p = chain_[p]){
+	if (codes_2[p] != codes_1[j])
+	  continue;
+	if (j >= p && j-p < (int)forward_.size())
+	  forward_[j-p] = 1;
+	if (p >= j && p-j < (int)reverse_.size())
+	  reverse_[p-j] = 1;
+      }
+    }
+  }
+
+  return mark_candidates(s1, s2, forward_) + mark_candidates(s2, s1, reverse_);
+}
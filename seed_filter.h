@@ -0,0 +1,51 @@
+#ifndef SEED_FILTER_H
+#define SEED_FILTER_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "string_view.h"
+
+/*
+ * Pigeonhole filter that rules out overlap offsets before they're verified. If an overlap of n bases
+ * may contain at most e mismatches, splitting it into e+1 blocks leaves at least one block of n/(e+1)
+ * bases that matches exactly. Whenever that block is at least seed_length bases long, the offset
+ * must share an exact seed of seed_length bases with the other read on the same diagonal. Offsets that
+ * allow too many mismatches for this guarantee are compared directly if the region is short and kept otherwise.
+ *
+ * The seeds of s2 are hashed once per pair and the seeds of s1 are looked up in the table, which
+ * yields the seeded offsets for both orientations at once. The mismatch budget of each offset
+ * mirrors the acceptance rules of ReadStitcher::kMismatch, so only offsets that could never be
+ * accepted are ruled out and the results of the search are unchanged
+ */
+class SeedFilter {
+ private:
+  int seed_length;
+  int max_k, min_bp_overlap;
+  double min_frac_correct;
+  std::vector<uint32_t> codes_1, codes_2;   // Code of the seed starting at each position of s1 and s2
+  std::vector<int> slots_, chain_;          // Hash table of the seeds of s2, chained through their positions
+  std::vector<char> forward_, reverse_;     // Whether each offset of each orientation is a candidate
+  std::vector<int> budgets_;                // Most mismatches an overlap of each length can contain. Grows as needed
+
+  const static int MAX_DIRECT_LENGTH = 32; // Longest region without a guaranteed seed that is compared directly
+
+  void encode(const StringView& s, std::vector<uint32_t>& codes);
+  int  mark_candidates(const StringView& first, const StringView& second, std::vector<char>& candidates);
+
+ public:
+  SeedFilter(int seed_length, int max_k, int min_bp_overlap, double min_frac_correct);
+
+  /*
+   * Determines which offsets of each orientation could satisfy the stitching requirements and
+   * returns the total number of candidate offsets. Requires reads that only contain A, C, G and T
+   */
+  int find_candidates(const StringView& s1, const StringView& s2);
+
+  /* Candidate flags for the last pair, indexed by offset. If reverse is true, s2 is assumed to be upstream of s1 */
+  const char* candidates(bool reverse){ return (reverse ? reverse_.data() : forward_.data()); }
+};
+
+#endif
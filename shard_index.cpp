@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "shard_index.h"
+#include "htslib/htslib/bgzf.h"
+
+ShardIndex::ShardIndex(std::string fastq, std::ostream& log){
+  filename     = fastq;
+  num_records_ = 0;
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0)
+    printErrorAndDie("Failed to read the size of FASTQ file " + filename);
+  file_size_ = info.st_size;
+  modified_  = info.st_mtime;
+
+  std::string path = filename + ".rsi";
+  if (load(path)){
+    log << "Loaded the shard index " << path << " (" << num_records_ << " records)" << std::endl;
+    return;
+  }
+  build();
+  if (write(path))
+    log << "Wrote the shard index " << path << " (" << num_records_ << " records)" << std::endl;
+  else
+    log << "Built a shard index for " << filename << " (" << num_records_ << " records), but couldn't save it to " << path << std::endl;
+}
+
+void ShardIndex::build(){
+  BGZF* input = bgzf_open(filename.c_str(), "r");
+  if (input == NULL)
+    printErrorAndDie("Failed to open FASTQ file " + filename);
+  if (bgzf_compression(input) == gzip)
+    printErrorAndDie("FASTQ file " + filename + " is gzipped rather than bgzipped, so it can't be split into shards. Recompress it with bgzip");
+
+  offsets_.clear();
+  num_records_ = 0;
+  kstring_t line = {0, 0, NULL};
+  while (true){
+    // The offset is taken before the record's first line is read, so seeking to it resumes at that record
+    int64_t offset = bgzf_tell(input);
+    int ret = bgzf_getline(input, '\n', &line);
+    if (ret == -1)
+      break;
+    if (ret < 0)
+      printErrorAndDie("Failed to decompress data from FASTQ file " + filename);
+    if (line.l == 0 || line.s[0] != '@')
+      printErrorAndDie("Read identifier is FASTQ file must begin with @ character");
+    if (num_records_ % INTERVAL == 0)
+      offsets_.push_back(offset);
+    for (int i = 0; i < 3; i++)
+      if (bgzf_getline(input, '\n', &line) < 0)
+	printErrorAndDie("FASTQ file " + filename + " ends with a truncated record");
+    num_records_++;
+  }
+  free(line.s);
+  if (bgzf_close(input) != 0)
+    printErrorAndDie("Failed to close FASTQ file " + filename);
+}
+
+bool ShardIndex::load(const std::string& path){
+  std::ifstream input(path.c_str());
+  if (!input.is_open())
+    return false;
+
+  std::string line, key;
+  int64_t value;
+  int64_t file_size = -1, modified = -1, interval = -1, num_records = -1;
+  while (std::getline(input, line) && !line.empty() && line[0] == '#'){
+    std::istringstream fields(line.substr(1));
+    if (!(fields >> key >> value))
+      return false;
+    if (key.compare("file_size") == 0)
+      file_size = value;
+    else if (key.compare("modified") == 0)
+      modified = value;
+    else if (key.compare("interval") == 0)
+      interval = value;
+    else if (key.compare("records") == 0)
+      num_records = value;
+  }
+  if (file_size != file_size_ || modified != modified_ || interval != INTERVAL || num_records < 0)
+    return false;
+
+  offsets_.clear();
+  while (!line.empty()){
+    offsets_.push_back(strtoll(line.c_str(), NULL, 10));
+    if (!std::getline(input, line))
+      break;
+  }
+  num_records_ = num_records;
+  return (int64_t)offsets_.size() == (num_records_ + INTERVAL - 1)/INTERVAL;
+}
+
+bool ShardIndex::write(const std::string& path){
+  // Written to a temporary file and renamed, so shards started together never read a partial index
+  std::stringstream tmp_path;
+  tmp_path << path << ".tmp" << getpid();
+  std::ofstream output(tmp_path.str().c_str());
+  if (!output.is_open())
+    return false;
+  output << "#file_size\t" << file_size_   << "\n"
+	 << "#modified\t"  << modified_    << "\n"
+	 << "#interval\t"  << INTERVAL     << "\n"
+	 << "#records\t"   << num_records_ << "\n";
+  for (size_t i = 0; i < offsets_.size(); i++)
+    output << offsets_[i] << "\n";
+  output.close();
+  if (output.fail() || rename(tmp_path.str().c_str(), path.c_str()) != 0){
+    remove(tmp_path.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+ShardRange ShardIndex::shard_range(int shard, int num_shards) const {
+  int64_t num_entries = offsets_.size();
+  int64_t first_entry = num_entries*shard/num_shards;
+  int64_t end_entry   = num_entries*(shard+1)/num_shards;
+
+  ShardRange range;
+  range.first_record = std::min(first_entry*INTERVAL, num_records_);
+  range.offset       = (first_entry < num_entries ? offsets_[first_entry] : -1);
+  range.num_records  = (end_entry == num_entries ? -1 : (end_entry - first_entry)*INTERVAL);
+  if (first_entry == num_entries)
+    range.num_records = 0;
+  return range;
+}
@@ -0,0 +1,54 @@
+#ifndef SHARD_INDEX_H
+#define SHARD_INDEX_H
+
+#include <stdint.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The records of a FASTQ file that one shard processes
+class ShardRange {
+public:
+  int64_t offset;          // BGZF virtual offset of the first record
+  int64_t first_record;
+  int64_t num_records;     // -1 if the shard runs to the end of the file
+};
+
+/*
+ * Record-aligned split points for a bgzipped or uncompressed FASTQ file. The BGZF virtual offset of every INTERVAL-th
+ * record is stored, so the two files of a paired run have split points at the same records and a shard can seek
+ * straight to its first pair. Indexes are cached next to the FASTQ as <fastq>.rsi and rebuilt if the FASTQ changes.
+ * Plain gzip files can't be indexed, as they can only be decompressed from the start
+ */
+class ShardIndex {
+private:
+  std::string filename;
+  int64_t file_size_;
+  int64_t modified_;
+  int64_t num_records_;
+  std::vector<int64_t> offsets_;  // Virtual offset of record i*INTERVAL
+
+  // Reads the whole file once, recording the offset of every INTERVAL-th record
+  void build();
+  // Returns false if the cached index doesn't exist or describes a different version of the file
+  bool load(const std::string& path);
+  bool write(const std::string& path);
+
+public:
+  // Even, so that split points of interleaved files fall between pairs
+  const static int64_t INTERVAL = 4096;
+
+  /* Loads the cached index for fastq, or builds it and tries to cache it */
+  ShardIndex(std::string fastq, std::ostream& log);
+
+  int64_t num_records() const { return num_records_; }
+
+  /*
+   * Divides the split points evenly between num_shards shards and returns the records of the shard-th one,
+   * numbering shards from 0. Shards are empty if there are more of them than split points
+   */
+  ShardRange shard_range(int shard, int num_shards) const;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include <algorithm>
+
+#include "sparse_table_lca.h"
+
+void SparseTableLCA::processTree(SuffixTree& tree){
+  num_nodes = tree.getNumNodes();
+  depths.resize(num_nodes);
+  parent_depths.resize(num_nodes);
+  depths[0]        = tree.getDepth(0);
+  parent_depths[0] = -1;
+  for (int i = 1; i < num_nodes; i++){
+    depths[i]        = tree.getDepth(i);
+    parent_depths[i] = depths[tree.getParent(i)];
+  }
+
+  int num_levels = 1;
+  while ((1 << num_levels) <= num_nodes)
+    num_levels++;
+  table.resize(num_levels*num_nodes);
+
+  for (int i = 0; i < num_nodes; i++)
+    table[i] = i;
+  for (int k = 1; k < num_levels; k++){
+    const int* prev = &table[(k-1)*num_nodes];
+    int* cur        = &table[k*num_nodes];
+    int half        = 1 << (k-1);
+    for (int i = 0; i + (1 << k) <= num_nodes; i++)
+      cur[i] = (parent_depths[prev[i]] <= parent_depths[prev[i+half]] ? prev[i] : prev[i+half]);
+  }
+}
+
+// Returns the node in [lo, hi] whose parent has the smallest string depth
+inline int SparseTableLCA::shallowest(int lo, int hi){
+  int k = 31 - __builtin_clz(hi - lo + 1);
+  int a = table[k*num_nodes + lo];
+  int b = table[k*num_nodes + hi - (1 << k) + 1];
+  return (parent_depths[a] <= parent_depths[b] ? a : b);
+}
+
+int SparseTableLCA::lcaNode(SuffixTree& tree, int x, int y){
+  if (x > y)
+    std::swap(x, y);
+  // Check if x is an ancestor of y (or the same node)
+  if (y <= x + tree.getNumDescendants(x))
+    return x;
+  return tree.getParent(shallowest(x+1, y));
+}
+
+int SparseTableLCA::longestPrefix(SuffixTree& tree, int sfx_idx_1, int sfx_idx_2){
+  int x = tree.getSuffix(sfx_idx_1);
+  int y = tree.getSuffix(sfx_idx_2);
+  if (x == y)
+    return depths[x];
+  if (x > y)
+    std::swap(x, y);
+  // Suffixes end at distinct leaves, so neither is an ancestor of the other
+  return parent_depths[shallowest(x+1, y)];
+}
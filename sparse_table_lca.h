@@ -0,0 +1,33 @@
+#ifndef SPARSE_TABLE_LCA_H
+#define SPARSE_TABLE_LCA_H
+
+#include <vector>
+
+#include "lca_backend.h"
+#include "suffix_tree.h"
+
+/*
+ * LCA via range minimum queries over the DFS order. This is the Euler tour reduction specialized to a preorder
+ * numbering: for nodes u < v, where u isn't an ancestor of v, the LCA is the parent of the node in (u, v] whose
+ * parent has the smallest string depth, as only the LCA's children in that range have the LCA as their parent.
+ * This needs an array with one entry per node rather than the 2n-1 entries of a full Euler tour, and queries
+ * take two sparse table lookups and no bit manipulation
+ */
+class SparseTableLCA : public LCABackend {
+ private:
+  int num_nodes;
+  std::vector<int> table;          // Level k holds the result of shallowest() for [i, i+2^k) at table[k*num_nodes+i]
+  std::vector<int> depths;         // String depth of each node, copied from the tree for locality
+  std::vector<int> parent_depths;  // String depth of each node's parent
+
+  int shallowest(int lo, int hi);
+
+ public:
+  SparseTableLCA(){ num_nodes = 0; }
+
+  void processTree(SuffixTree& tree);
+  int  lcaNode(SuffixTree& tree, int x, int y);
+  int  longestPrefix(SuffixTree& tree, int sfx_idx_1, int sfx_idx_2);
+};
+
+#endif
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stitch_stats.h"
+
+static const char* STATUS_NAMES[NUM_STITCH_STATUSES] = {"stitched", "unstitched", "trim_failed", "n_skipped"};
+
+StitchStats::StitchStats(){
+  std::fill(status, status+NUM_STITCH_STATUSES, 0);
+  std::fill(orientation, orientation+2, 0);
+  std::fill(adapters, adapters+2, 0);
+  overlap_mismatches.assign(MAX_LENGTH*MAX_MISMATCHES, 0);
+  trimmed[0].assign(MAX_LENGTH, 0);
+  trimmed[1].assign(MAX_LENGTH, 0);
+  std::fill(match_quals,    match_quals+256,    0);
+  std::fill(mismatch_quals, mismatch_quals+256, 0);
+}
+
+void StitchStats::merge(const StitchStats& other){
+  for (int i = 0; i < NUM_STITCH_STATUSES; i++)
+    status[i] += other.status[i];
+  for (int i = 0; i < 2; i++){
+    orientation[i] += other.orientation[i];
+    adapters[i]    += other.adapters[i];
+  }
+  for (size_t i = 0; i < overlap_mismatches.size(); i++)
+    overlap_mismatches[i] += other.overlap_mismatches[i];
+  for (int read = 0; read < 2; read++)
+    for (int i = 0; i < MAX_LENGTH; i++)
+      trimmed[read][i] += other.trimmed[read][i];
+  for (int i = 0; i < 256; i++){
+    match_quals[i]    += other.match_quals[i];
+    mismatch_quals[i] += other.mismatch_quals[i];
+  }
+}
+
+/* Writes the non-empty bins of a histogram as a JSON array of [bin, count] pairs */
+static void write_json_bins(std::ostream& out, const int64_t* counts, int num_bins){
+  out << "[";
+  bool first = true;
+  for (int i = 0; i < num_bins; i++){
+    if (counts[i] == 0)
+      continue;
+    out << (first ? "" : ", ") << "[" << i << ", " << counts[i] << "]";
+    first = false;
+  }
+  out << "]";
+}
+
+/* Writes the non-empty bins of a histogram as TSV rows */
+static void write_tsv_bins(std::ostream& out, const char* section, const int64_t* counts, int num_bins){
+  for (int i = 0; i < num_bins; i++)
+    if (counts[i] != 0)
+      out << section << "\t" << i << "\t" << counts[i] << "\n";
+}
+
+void StitchStats::write_json(std::ostream& out, const SearchStats& search){
+  std::vector<int64_t> overlaps(MAX_LENGTH, 0), mismatches(MAX_MISMATCHES, 0);
+  for (int i = 0; i < MAX_LENGTH; i++){
+    for (int j = 0; j < MAX_MISMATCHES; j++){
+      overlaps[i]   += overlap_mismatches[i*MAX_MISMATCHES + j];
+      mismatches[j] += overlap_mismatches[i*MAX_MISMATCHES + j];
+    }
+  }
+
+  out << "{\n";
+  out << "  \"pairs\": {";
+  for (int i = 0; i < NUM_STITCH_STATUSES; i++)
+    out << (i == 0 ? "" : ", ") << "\"" << STATUS_NAMES[i] << "\": " << status[i];
+  out << "},\n";
+  out << "  \"orientation\": {\"read_1_upstream\": " << orientation[0] << ", \"read_2_upstream\": " << orientation[1] << "},\n";
+  out << "  \"adapters\": {\"read_1\": " << adapters[0] << ", \"read_2\": " << adapters[1] << "},\n";
+  out << "  \"overlap\": ";
+  write_json_bins(out, overlaps.data(), MAX_LENGTH);
+  out << ",\n  \"mismatches\": ";
+  write_json_bins(out, mismatches.data(), MAX_MISMATCHES);
+
+  out << ",\n  \"overlap_mismatches\": [";
+  bool first = true;
+  for (int i = 0; i < MAX_LENGTH; i++){
+    for (int j = 0; j < MAX_MISMATCHES; j++){
+      int64_t count = overlap_mismatches[i*MAX_MISMATCHES + j];
+      if (count == 0)
+	continue;
+      out << (first ? "" : ", ") << "[" << i << ", " << j << ", " << count << "]";
+      first = false;
+    }
+  }
+  out << "]";
+
+  out << ",\n  \"trimmed_bases\": {\"read_1\": ";
+  write_json_bins(out, trimmed[0].data(), MAX_LENGTH);
+  out << ", \"read_2\": ";
+  write_json_bins(out, trimmed[1].data(), MAX_LENGTH);
+  out << "}";
+
+  // Quality scores are keyed by their ASCII codes
+  out << ",\n  \"base_quality\": {\"match\": ";
+  write_json_bins(out, match_quals, 256);
+  out << ", \"mismatch\": ";
+  write_json_bins(out, mismatch_quals, 256);
+  out << "}";
+
+  out << ",\n  \"overlap_search\": {\"pairs_rejected\": " << search.pairs_rejected << ", \"offsets\": " << search.offsets
+      << ", \"offsets_filtered\": " << search.offsets_filtered << ", \"offsets_skipped\": " << search.offsets_skipped
+      << ", \"walks_aborted\": " << search.walks_aborted << "}\n";
+  out << "}" << std::endl;
+}
+
+void StitchStats::write_tsv(std::ostream& out, const SearchStats& search){
+  out << "section\tkey\tcount\n";
+  for (int i = 0; i < NUM_STITCH_STATUSES; i++)
+    out << "pairs\t" << STATUS_NAMES[i] << "\t" << status[i] << "\n";
+  out << "orientation\tread_1_upstream\t" << orientation[0] << "\n";
+  out << "orientation\tread_2_upstream\t" << orientation[1] << "\n";
+  out << "adapters\tread_1\t" << adapters[0] << "\n";
+  out << "adapters\tread_2\t" << adapters[1] << "\n";
+
+  for (int i = 0; i < MAX_LENGTH; i++){
+    for (int j = 0; j < MAX_MISMATCHES; j++){
+      int64_t count = overlap_mismatches[i*MAX_MISMATCHES + j];
+      if (count != 0)
+	out << "overlap_mismatches\t" << i << ":" << j << "\t" << count << "\n";
+    }
+  }
+
+  write_tsv_bins(out, "trimmed_bases_read_1", trimmed[0].data(), MAX_LENGTH);
+  write_tsv_bins(out, "trimmed_bases_read_2", trimmed[1].data(), MAX_LENGTH);
+  write_tsv_bins(out, "base_quality_match",    match_quals,    256);
+  write_tsv_bins(out, "base_quality_mismatch", mismatch_quals, 256);
+
+  out << "overlap_search\tpairs_rejected\t"   << search.pairs_rejected   << "\n";
+  out << "overlap_search\toffsets\t"          << search.offsets          << "\n";
+  out << "overlap_search\toffsets_filtered\t" << search.offsets_filtered << "\n";
+  out << "overlap_search\toffsets_skipped\t"  << search.offsets_skipped  << "\n";
+  out << "overlap_search\twalks_aborted\t"    << search.walks_aborted    << std::endl;
+}
+
+/* Parses a bin of a write_tsv_bins() row and adds the count to the histogram. Returns false if the bin is out of range */
+static bool read_tsv_bin(const std::string& key, int64_t count, int64_t* counts, int num_bins){
+  int bin = atoi(key.c_str());
+  if (bin < 0 || bin >= num_bins)
+    return false;
+  counts[bin] = count;
+  return true;
+}
+
+bool StitchStats::read_tsv(std::istream& in, SearchStats& search){
+  *this = StitchStats();
+  search = SearchStats();
+  std::string line, section, key;
+  int64_t count;
+  if (!std::getline(in, line) || line.compare("section\tkey\tcount") != 0)
+    return false;
+  while (std::getline(in, line)){
+    std::istringstream fields(line);
+    if (!std::getline(fields, section, '\t') || !std::getline(fields, key, '\t') || !(fields >> count))
+      return false;
+
+    bool valid = true;
+    if (section.compare("pairs") == 0){
+      valid = false;
+      for (int i = 0; i < NUM_STITCH_STATUSES; i++){
+	if (key.compare(STATUS_NAMES[i]) == 0){
+	  status[i] = count;
+	  valid     = true;
+	}
+      }
+    }
+    else if (section.compare("orientation") == 0 && key.compare("read_1_upstream") == 0)
+      orientation[0] = count;
+    else if (section.compare("orientation") == 0 && key.compare("read_2_upstream") == 0)
+      orientation[1] = count;
+    else if (section.compare("adapters") == 0 && key.compare("read_1") == 0)
+      adapters[0] = count;
+    else if (section.compare("adapters") == 0 && key.compare("read_2") == 0)
+      adapters[1] = count;
+    else if (section.compare("overlap_mismatches") == 0){
+      int overlap, mismatches;
+      valid = (sscanf(key.c_str(), "%d:%d", &overlap, &mismatches) == 2 && overlap >= 0 && overlap < MAX_LENGTH
+	       && mismatches >= 0 && mismatches < MAX_MISMATCHES);
+      if (valid)
+	overlap_mismatches[overlap*MAX_MISMATCHES + mismatches] = count;
+    }
+    else if (section.compare("trimmed_bases_read_1") == 0)
+      valid = read_tsv_bin(key, count, trimmed[0].data(), MAX_LENGTH);
+    else if (section.compare("trimmed_bases_read_2") == 0)
+      valid = read_tsv_bin(key, count, trimmed[1].data(), MAX_LENGTH);
+    else if (section.compare("base_quality_match") == 0)
+      valid = read_tsv_bin(key, count, match_quals, 256);
+    else if (section.compare("base_quality_mismatch") == 0)
+      valid = read_tsv_bin(key, count, mismatch_quals, 256);
+    else if (section.compare("overlap_search") == 0){
+      if (key.compare("pairs_rejected") == 0)
+	search.pairs_rejected = count;
+      else if (key.compare("offsets") == 0)
+	search.offsets = count;
+      else if (key.compare("offsets_filtered") == 0)
+	search.offsets_filtered = count;
+      else if (key.compare("offsets_skipped") == 0)
+	search.offsets_skipped = count;
+      else if (key.compare("walks_aborted") == 0)
+	search.walks_aborted = count;
+      else
+	valid = false;
+    }
+    else
+      valid = false;
+    if (!valid)
+      return false;
+  }
+  return true;
+}
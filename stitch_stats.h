@@ -0,0 +1,68 @@
+#ifndef STITCH_STATS_H
+#define STITCH_STATS_H
+
+#include <stdint.h>
+
+#include <iostream>
+#include <vector>
+
+#include "search_stats.h"
+
+// Outcome of processing a single pair of reads
+enum StitchStatus {
+  STITCHED,        // Written to the stitched output
+  UNSTITCHED,      // Stitching failed; written to the _1 and _2 outputs
+  TRIM_FAILED,     // At least one read was empty after trimming; not written
+  N_SKIPPED,       // At least one read contained an N; not written
+  NUM_STITCH_STATUSES
+};
+
+/*
+ * Fixed-size histograms describing a run, accumulated by each stitcher without locking and merged once the
+ * run is complete. All of the arrays are allocated up front, so recording a pair never allocates.
+ * Lengths and mismatch counts beyond the last bin of a histogram are counted in its last bin
+ */
+class StitchStats {
+ public:
+  const static int MAX_LENGTH     = 1024;
+  const static int MAX_MISMATCHES = 64;
+
+  int64_t status[NUM_STITCH_STATUSES];
+  int64_t orientation[2];                  // Stitched pairs with the first read upstream (0) or the second read upstream (1)
+  int64_t adapters[2];                     // First and second reads that had adapter sequence removed
+  std::vector<int64_t> overlap_mismatches; // Joint histogram of overlap length and mismatches, MAX_MISMATCHES bins per overlap length
+  std::vector<int64_t> trimmed[2];         // Bases trimmed from each read of a pair
+  int64_t match_quals[256];                // Lower base quality at matching and mismatching overlap positions
+  int64_t mismatch_quals[256];
+
+  StitchStats();
+
+  void add_status(StitchStatus s){ status[s]++; }
+
+  void add_adapter(int read){ adapters[read]++; }
+
+  void add_trim(int read, int num_bases){ trimmed[read][bin(num_bases, MAX_LENGTH)]++; }
+
+  void add_stitch(bool reverse, int num_bp_overlap, int num_mismatches){
+    orientation[reverse ? 1 : 0]++;
+    overlap_mismatches[bin(num_bp_overlap, MAX_LENGTH)*MAX_MISMATCHES + bin(num_mismatches, MAX_MISMATCHES)]++;
+  }
+
+  void add_overlap_base(char min_qual, bool match){ (match ? match_quals : mismatch_quals)[(unsigned char)min_qual]++; }
+
+  void merge(const StitchStats& other);
+
+  /* Writes the histograms and the search counters as a JSON object */
+  void write_json(std::ostream& out, const SearchStats& search);
+
+  /* Writes the histograms and the search counters as tab-separated section, key and count rows */
+  void write_tsv(std::ostream& out, const SearchStats& search);
+
+  /* Replaces the histograms and the search counters with those in a report written by write_tsv(). Returns false if it's malformed */
+  bool read_tsv(std::istream& in, SearchStats& search);
+
+ private:
+  static int bin(int value, int num_bins){ return (value < num_bins ? value : num_bins-1); }
+};
+
+#endif
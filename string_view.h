@@ -0,0 +1,25 @@
+#ifndef STRING_VIEW_H
+#define STRING_VIEW_H
+
+#include <string>
+
+// Read-only view of a run of characters owned by another object, such as the trimmed sequence of a read in a ReadBatch
+class StringView {
+ public:
+  const char* data;
+  int size;
+
+  StringView(const char* data, int size){
+    this->data = data;
+    this->size = size;
+  }
+
+  StringView(const std::string& s){
+    data = s.data();
+    size = s.size();
+  }
+
+  char operator[](int i) const { return data[i]; }
+};
+
+#endif
@@ -1,32 +1,51 @@
 #include <algorithm>
+#include <cctype>
+#include <sstream>
 
 #include "error.h"
 #include "stringops.h"
 
-void reverse_complement(std::string& sequence){
-  for (unsigned int i = 0; i < sequence.size(); i++){
-    switch(sequence[i]){
-    case 'A':
-      sequence[i] = 'T';
-      break;
-    case 'C':
-      sequence[i] = 'G';
-      break;
-    case 'G':
-      sequence[i] = 'C';
-      break;
-    case 'T':
-      sequence[i] = 'A';
-      break;
-    case 'N':
-      sequence[i] = 'N';
-      break;
-    default:
-      printErrorAndDie("Invalid character encountered in reverse_complement function");
-      break;
-    }
+// Complement of each base, or 0 for characters that can't be reverse complemented
+class ComplementTable {
+public:
+  char complement[256];
+
+  ComplementTable(){
+    std::fill(complement, complement+256, 0);
+    complement['A'] = 'T';
+    complement['C'] = 'G';
+    complement['G'] = 'C';
+    complement['T'] = 'A';
+    complement['N'] = 'N';
+  }
+};
+
+static const ComplementTable COMPLEMENT_TABLE;
+
+static inline char complement_base(char base){
+  char complement = COMPLEMENT_TABLE.complement[(unsigned char)base];
+  if (complement == 0)
+    printErrorAndDie("Invalid character encountered in reverse_complement function");
+  return complement;
+}
+
+void reverse_complement(char* sequence, size_t length){
+  // Swaps the ends inwards, complementing both, so each base is visited once
+  for (size_t i = 0, j = length; i < j; i++, j--){
+    char first   = complement_base(sequence[i]);
+    sequence[i]  = complement_base(sequence[j-1]);
+    sequence[j-1] = first;
   }
-  std::reverse(sequence.begin(), sequence.end());
+}
+
+void reverse_complement(const char* sequence, size_t length, char* dest){
+  for (size_t i = 0; i < length; i++)
+    dest[length-1-i] = complement_base(sequence[i]);
+}
+
+void reverse_complement(std::string& sequence){
+  if (!sequence.empty())
+    reverse_complement(&sequence[0], sequence.size());
 }
 
 bool string_ends_with(std::string& s, std::string suffix){
@@ -34,3 +53,19 @@ bool string_ends_with(std::string& s, std::string suffix){
     return false;
   return s.substr(s.size()-suffix.size(), suffix.size()).compare(suffix) == 0;
 }
+
+std::vector<std::string> split_string(const std::string& s, char delim){
+  std::vector<std::string> items;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, delim))
+    items.push_back(item);
+  return items;
+}
+
+std::string uppercase(const std::string& s){
+  std::string result(s);
+  for (size_t i = 0; i < result.size(); i++)
+    result[i] = toupper(result[i]);
+  return result;
+}
@@ -1,8 +1,24 @@
 #ifndef STRING_OPS_H_
 #define STRING_OPS_H_
 
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
 void reverse_complement(std::string& sequence);
 
+/* Reverse complements the sequence in place */
+void reverse_complement(char* sequence, size_t length);
+
+/* Writes the reverse complement of sequence to dest, which must not overlap it */
+void reverse_complement(const char* sequence, size_t length, char* dest);
+
 bool string_ends_with(std::string& s, std::string suffix);
 
+/* Splits s at each occurrence of delim */
+std::vector<std::string> split_string(const std::string& s, char delim);
+
+std::string uppercase(const std::string& s);
+
 #endif
@@ -0,0 +1,207 @@
+#include <algorithm>
+
+#include "error.h"
+#include "suffix_array.h"
+
+SuffixArray::SuffixArray(){
+  for (int i = 0; i < 256; i++)
+    charID[i] = -1;
+  // $ sorts first, followed by the bases and then the separator
+  charID['$'] = 0;
+  charID['A'] = 1;
+  charID['C'] = 2;
+  charID['G'] = 3;
+  charID['T'] = 4;
+  charID['#'] = 5;
+}
+
+SuffixArray::~SuffixArray(){
+  for (size_t i = 0; i < levels_.size(); i++)
+    delete levels_[i];
+}
+
+void SuffixArray::induce(SAISWorkspace& w, const int* s, int n, const std::vector<int>& lms){
+  std::vector<int>& sa = w.sa;
+  std::fill(sa.begin(), sa.end(), -1);
+
+  // Place the LMS suffixes at the ends of their S buckets
+  std::copy(w.sum_s.begin(), w.sum_s.end(), w.buckets.begin());
+  for (size_t i = 0; i < lms.size(); i++)
+    if (lms[i] != n)
+      sa[w.buckets[s[lms[i]]]++] = lms[i];
+
+  // Induce the L-type suffixes from left to right
+  std::copy(w.sum_l.begin(), w.sum_l.end(), w.buckets.begin());
+  sa[w.buckets[s[n-1]]++] = n-1;
+  for (int i = 0; i < n; i++){
+    int v = sa[i];
+    if (v >= 1 && !w.is_s[v-1])
+      sa[w.buckets[s[v-1]]++] = v-1;
+  }
+
+  // Induce the S-type suffixes from right to left
+  std::copy(w.sum_l.begin(), w.sum_l.end(), w.buckets.begin());
+  for (int i = n-1; i >= 0; i--){
+    int v = sa[i];
+    if (v >= 1 && w.is_s[v-1])
+      sa[--w.buckets[s[v-1]+1]] = v-1;
+  }
+}
+
+void SuffixArray::sais(size_t level, const int* s, int n, int upper){
+  while (levels_.size() <= level)
+    levels_.push_back(new SAISWorkspace());
+  SAISWorkspace& w = *levels_[level];
+  w.sa.resize(n);
+
+  if (n == 1){
+    w.sa[0] = 0;
+    return;
+  }
+  if (n == 2){
+    w.sa[0] = (s[0] < s[1] ? 0 : 1);
+    w.sa[1] = 1 - w.sa[0];
+    return;
+  }
+
+  // Classify each suffix as S-type or L-type
+  w.is_s.assign(n, 0);
+  for (int i = n-2; i >= 0; i--)
+    w.is_s[i] = (s[i] == s[i+1] ? w.is_s[i+1] : s[i] < s[i+1]);
+
+  // Bucket boundaries for each character
+  w.sum_l.assign(upper+1, 0);
+  w.sum_s.assign(upper+1, 0);
+  w.buckets.resize(upper+1);
+  for (int i = 0; i < n; i++){
+    if (!w.is_s[i])
+      w.sum_s[s[i]]++;
+    else
+      w.sum_l[s[i]+1]++;
+  }
+  for (int i = 0; i <= upper; i++){
+    w.sum_s[i] += w.sum_l[i];
+    if (i < upper)
+      w.sum_l[i+1] += w.sum_s[i];
+  }
+
+  // Sort the LMS substrings by inducing from their unsorted positions
+  w.lms_map.assign(n+1, -1);
+  w.lms.clear();
+  for (int i = 1; i < n; i++){
+    if (!w.is_s[i-1] && w.is_s[i]){
+      w.lms_map[i] = w.lms.size();
+      w.lms.push_back(i);
+    }
+  }
+  int m = w.lms.size();
+  induce(w, s, n, w.lms);
+  if (m == 0)
+    return;
+
+  // Name the sorted LMS substrings and recursively sort the reduced string
+  w.sorted_lms.clear();
+  for (int i = 0; i < n; i++)
+    if (w.lms_map[w.sa[i]] != -1)
+      w.sorted_lms.push_back(w.sa[i]);
+  w.reduced.resize(m);
+  int rec_upper = 0;
+  w.reduced[w.lms_map[w.sorted_lms[0]]] = 0;
+  for (int i = 1; i < m; i++){
+    int l = w.sorted_lms[i-1], r = w.sorted_lms[i];
+    int end_l = (w.lms_map[l]+1 < m ? w.lms[w.lms_map[l]+1] : n);
+    int end_r = (w.lms_map[r]+1 < m ? w.lms[w.lms_map[r]+1] : n);
+    bool same = true;
+    if (end_l - l != end_r - r)
+      same = false;
+    else {
+      while (l < end_l && s[l] == s[r]){
+	l++;
+	r++;
+      }
+      if (l == n || s[l] != s[r])
+	same = false;
+    }
+    if (!same)
+      rec_upper++;
+    w.reduced[w.lms_map[w.sorted_lms[i]]] = rec_upper;
+  }
+
+  sais(level+1, w.reduced.data(), m, rec_upper);
+  const std::vector<int>& rec_sa = levels_[level+1]->sa;
+  for (int i = 0; i < m; i++)
+    w.sorted_lms[i] = w.lms[rec_sa[i]];
+  induce(w, s, n, w.sorted_lms);
+}
+
+void SuffixArray::buildLCP(){
+  // Kasai's algorithm: lcp_[r] is the longest common prefix of the suffixes ranked r-1 and r
+  const std::vector<int>& sa = levels_[0]->sa;
+  int n = ids.size();
+  rank_.resize(n);
+  lcp_.assign(n, 0);
+  for (int i = 0; i < n; i++)
+    rank_[sa[i]] = i;
+
+  int h = 0;
+  for (int i = 0; i < n; i++){
+    if (rank_[i] == 0){
+      h = 0;
+      continue;
+    }
+    int j = sa[rank_[i]-1];
+    // The unique trailing $ guarantees a mismatch before either suffix runs out
+    while (ids[i+h] == ids[j+h])
+      h++;
+    lcp_[rank_[i]] = h;
+    if (h > 0)
+      h--;
+  }
+}
+
+void SuffixArray::buildSparseTable(){
+  int n = lcp_.size();
+  int num_levels = 1;
+  while ((1 << num_levels) <= n)
+    num_levels++;
+  sparse_.resize(num_levels*n);
+
+  std::copy(lcp_.begin(), lcp_.end(), sparse_.begin());
+  for (int k = 1; k < num_levels; k++){
+    const int* prev = &sparse_[(k-1)*n];
+    int* cur        = &sparse_[k*n];
+    int half        = 1 << (k-1);
+    for (int i = 0; i + (1 << k) <= n; i++)
+      cur[i] = std::min(prev[i], prev[i+half]);
+  }
+}
+
+void SuffixArray::build(const std::string& joined){
+  ProfileScope scope(profile_, STAGE_INDEX_BUILD);
+  ids.clear();
+  for (size_t i = 0; i < joined.size(); i++){
+    int id = charID[(unsigned char)joined[i]];
+    if (id == -1)
+      printErrorAndDie("Invalid character encountered in SuffixArray::build");
+    ids.push_back(id);
+  }
+  ids.push_back(charID['$']);
+
+  sais(0, ids.data(), ids.size(), 5);
+  buildLCP();
+  // The range minimum query table plays the role of the suffix tree's LCA preprocessing
+  ProfileScope rmq_scope(profile_, STAGE_LCA_PREPROCESS);
+  buildSparseTable();
+}
+
+int SuffixArray::longestPrefix(int sfx_idx_1, int sfx_idx_2){
+  if (sfx_idx_1 == sfx_idx_2)
+    return ids.size() - sfx_idx_1;
+
+  int r1 = rank_[sfx_idx_1], r2 = rank_[sfx_idx_2];
+  int lo = std::min(r1, r2) + 1;
+  int hi = std::max(r1, r2);
+  int k  = 31 - __builtin_clz(hi - lo + 1);
+  int n  = lcp_.size();
+  return std::min(sparse_[k*n + lo], sparse_[k*n + hi - (1 << k) + 1]);
+}
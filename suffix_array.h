@@ -0,0 +1,51 @@
+#ifndef SUFFIX_ARRAY_H
+#define SUFFIX_ARRAY_H
+
+#include <string>
+#include <vector>
+
+#include "lce_index.h"
+
+/*
+ * LCE index backed by a suffix array and LCP array. The suffix array is built in linear time with SA-IS,
+ * the LCP array with Kasai's algorithm, and queries are answered in O(1) by a sparse table range minimum
+ * query over the LCP array. All of the buffers, including the SA-IS workspace for each level of recursion,
+ * are reused when the index is rebuilt
+ */
+class SuffixArray : public LCEIndex {
+ private:
+  // Scratch space for one level of the SA-IS recursion
+  class SAISWorkspace {
+  public:
+    std::vector<int>  sa;
+    std::vector<char> is_s;   // Whether each suffix is S-type (smaller than the following suffix)
+    std::vector<int>  sum_l, sum_s, buckets;
+    std::vector<int>  lms_map, lms, sorted_lms, reduced;
+  };
+
+  int charID[256];
+  std::vector<int> ids;
+  std::vector<int> rank_;
+  std::vector<int> lcp_;
+  std::vector<int> sparse_;       // Level k holds the minimum of lcp_[i, i+2^k) at sparse_[k*n+i]
+  std::vector<SAISWorkspace*> levels_;
+
+  void sais(size_t level, const int* s, int n, int upper);
+  void induce(SAISWorkspace& w, const int* s, int n, const std::vector<int>& lms);
+  void buildLCP();
+  void buildSparseTable();
+
+  SuffixArray(const SuffixArray&);
+  SuffixArray& operator=(const SuffixArray&);
+
+ public:
+  SuffixArray();
+  ~SuffixArray();
+
+  void build(const std::string& joined);
+  int  longestPrefix(int sfx_idx_1, int sfx_idx_2);
+
+  const std::vector<int>& getSuffixArray(){ return levels_[0]->sa; }
+};
+
+#endif
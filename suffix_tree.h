@@ -1,6 +1,7 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <stdint.h>
 #include <stdlib.h>
 
 #ifndef SUFFIX_TREE_H
@@ -9,125 +10,61 @@
 
 void printErrorAndDie(std::string fname, std::string error);
 
-class Node {
-private:
-  Node*    parent;
-  size_t*  starts[NUM_CHARS];
-  size_t*  stops[NUM_CHARS];
-  bool     global[NUM_CHARS];
-  Node*    children[NUM_CHARS];
-  Node*    sfx_link;
-  int      edge_idx;
-  size_t   label;
-  int      depth;
-  int      num_descendants;
-
-public:
-  Node(Node* myParent, int my_edge_idx){
-    parent = myParent;
-    for(int i = 0; i < NUM_CHARS; i++){
-      starts[i]   = NULL;
-      stops[i]    = NULL;
-      children[i] = NULL;
-      global[i]   = false;
-    }
-    sfx_link = NULL;
-    edge_idx = my_edge_idx;
-    depth    = -1;
-    num_descendants = 0;
-  }
-
-  ~Node(){
-    for(int i = 0; i < NUM_CHARS; i++){
-      delete starts[i];
-      if(!global[i])
-	delete stops[i];
-      if(children[i] != NULL)
-	delete children[i];
-    }
-  }
-
-  void setGlobalStop(int edge_idx, size_t*& stop){
-    delete stops[edge_idx];
-    stops[edge_idx]  = stop;                      
-    global[edge_idx] = true;
-  }
-
-  void unsetGlobalStop(int edge_idx){
-    if(!global[edge_idx])
-      printErrorAndDie("unsetGlobalStop()", "Cannot unset a non-global stop");
-    global[edge_idx] = false;
-    size_t val       = *stops[edge_idx];
-    stops[edge_idx]  = new size_t;
-    *stops[edge_idx] = val;
-  }
-
-  int    getEdgeIndex()              { return edge_idx;                             }
-  Node*  getParent()                 { return parent;                               }
-  int    getDepth()                  { return depth;                                }
-  size_t getStart(int edge_idx)      { return *starts[edge_idx];                    }
-  size_t getStop(int edge_idx)       { return *stops[edge_idx];                     }
-  size_t getNumChars(int edge_idx)   { return *stops[edge_idx]-*starts[edge_idx]+1; } 
-  void   setLabel(size_t my_label)   { label = my_label;  }
-  size_t getLabel()                  { return label;      }
-  void   addDescendants(int ndesc)   { num_descendants += ndesc;                    }
-  int    getNumDescendants()         { return num_descendants;                      }
-  bool   isLeaf(int edge_idx)        { return children[edge_idx] == NULL;           }
-  bool   isRoot()                    { return parent == NULL;                       }
-  bool   edgeExists(int edge_idx)    { return starts[edge_idx] != NULL;             }
-  Node*  getChildNode(int edge_idx)  { return children[edge_idx];                   }
-  void   setSuffixLink(Node* link)   { sfx_link = link;                             }
-  Node*  getSuffixLink()             { return sfx_link;                             }
-
-  std::vector<Node*> getChildren(){
-    std::vector<Node*> my_children;
-    for(int i = 0; i < NUM_CHARS; i++)
-      if(children[i] != NULL)
-	my_children.push_back(children[i]);
-    return my_children;
-  }
-
-  void addEdge(int edge_idx, size_t start, size_t stop){
-    starts[edge_idx]  = new size_t;
-    stops[edge_idx]   = new size_t;
-    *starts[edge_idx] = start;
-    *stops[edge_idx]  = stop;
-  }
-
-  void extendEdge(int edge_idx);
-  void splitEdge(int edge_idx, size_t pos_idx, size_t char_idx, std::vector<int>& ids, size_t*& global_stop, std::string& tokens, Node*& new_node);
-  void print(std::ostream& out, int depth, std::string& word);
-  void dfsProcess(size_t& cur_label, int cur_depth, std::vector< std::pair<int, Node*> >& stack, int max_depth, std::vector<Node*>& suffixes);
-};
-
+/*
+ * Suffix tree stored as flat arrays of 32-bit indices rather than linked nodes.
+ *
+ * Construction (Ukkonen's algorithm) works on per-node edge and child arrays. Leaf edges don't store
+ * an end position, but implicitly extend to the global end of the string. Once built, the nodes are
+ * renumbered in DFS preorder, so node i's subtree spans nodes [i, i + getNumDescendants(i)], and the
+ * parent, string depth and descendant count of each node are stored in contiguous arrays.
+ * All of the arrays are reused when the tree is rebuilt, so steady-state rebuilds don't allocate
+ */
 class SuffixTree {
 private:
+  const static int32_t NONE = -1;
+
   std::string tokens;
   int charID[256];
   std::vector<int> ids;
-  size_t* global_end;
-  std::vector<Node*> nodes; // Indexed by label-1 
-  std::vector<Node*> suffixes;
+
+  // Construction-time layout, indexed by construction order
+  std::vector<int32_t> child_;       // NUM_CHARS entries per node
+  std::vector<int32_t> edge_start_;  // Start of the edge leading into each node
+  std::vector<int32_t> edge_end_;    // End (inclusive) of the edge leading into each node, or NONE for leaves
+  std::vector<int32_t> link_;        // Suffix links of internal nodes
+  int32_t num_built_;
+
+  // Final layout, indexed by DFS preorder
+  std::vector<int32_t> parent_;
+  std::vector<int32_t> depth_;
+  std::vector<int32_t> num_desc_;
+  std::vector<int32_t> suffixes_;    // Leaf for each suffix
+  std::vector< std::pair<int32_t, int32_t> > stack_;
 
   void stringToIds();
+  int32_t newNode(int32_t start, int32_t end);
   void createTree();
-  void traverseChars(Node* start_node, size_t start_idx, size_t stop_idx, 
-		     Node*& end_node, int& end_edge_idx, size_t& end_pos_idx);
-  int  extendCharacter(Node* node, int edge_idx, size_t pos_index, int char_id, size_t char_idx, 
-		       Node*& ins_node, int& ins_edge_idx, size_t& ins_pos_idx, size_t*& global_stop);
-  void getLinkInfo(Node* prev_node, int edge_idx, size_t pos_idx, Node*& node, size_t& gamma_start, size_t& gamma_stop); 
-  int  singleExtension(size_t i, size_t j, size_t*& global_stop, Node* prev_node, int edge_idx, size_t pos_idx, 
-		       Node*& new_node, int& new_edge_idx, size_t& new_pos_idx);
   void dfsProcess();
 
+  SuffixTree(const SuffixTree&);
+  SuffixTree& operator=(const SuffixTree&);
+
 public:
-  Node* root;
-  SuffixTree(std::string myString);
-  ~SuffixTree();
-  std::string getPathString(Node* node);
-  Node* getSuffix(int idx);
+  SuffixTree();
+  SuffixTree(const std::string& myString);
+
+  // (Re)builds the tree for the provided string, reusing the storage of any previous tree
+  void build(const std::string& myString);
+
+  int32_t getNumNodes()                   { return parent_.size();   }
+  int32_t getParent(int32_t node)         { return parent_[node];    }
+  int32_t getDepth(int32_t node)          { return depth_[node];     }
+  int32_t getNumDescendants(int32_t node) { return num_desc_[node];  }
+  int32_t getSuffix(int idx)              { return suffixes_[idx];   }
+  const int32_t* getParents()             { return parent_.data();   }
+
+  std::string getPathString(int32_t node);
   void printTree(std::ostream& out);
-  std::vector<Node*>& getNodes(){ return nodes; }
 };
 
 #endif
@@ -0,0 +1,43 @@
+#ifndef SUFFIX_TREE_LCE_H
+#define SUFFIX_TREE_LCE_H
+
+#include "lca.h"
+#include "lca_backend.h"
+#include "lce_index.h"
+#include "sparse_table_lca.h"
+#include "suffix_tree.h"
+
+// LCE index that answers queries with LCA queries on a suffix tree, using the selected LCA backend
+class SuffixTreeLCE : public LCEIndex {
+ private:
+  SuffixTree   tree;
+  LCABackend*  lca;
+
+  SuffixTreeLCE(const SuffixTreeLCE&);
+  SuffixTreeLCE& operator=(const SuffixTreeLCE&);
+
+ public:
+  SuffixTreeLCE(LCAMethod method, int max_nnodes){
+    if (method == SPARSE_TABLE_LCA)
+      lca = new SparseTableLCA();
+    else
+      lca = new LCA(max_nnodes);
+  }
+
+  ~SuffixTreeLCE(){ delete lca; }
+
+  void build(const std::string& joined){
+    {
+      ProfileScope scope(profile_, STAGE_INDEX_BUILD);
+      tree.build(joined);
+    }
+    ProfileScope scope(profile_, STAGE_LCA_PREPROCESS);
+    lca->processTree(tree);
+  }
+
+  int longestPrefix(int sfx_idx_1, int sfx_idx_2){
+    return lca->longestPrefix(tree, sfx_idx_1, sfx_idx_2);
+  }
+};
+
+#endif
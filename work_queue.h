@@ -0,0 +1,50 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/*
+ * Unbounded FIFO used to hand work between the threads of the stitching pipeline.
+ * Once close() has been called, pop() drains any remaining items and then returns false
+ */
+template<typename T> class WorkQueue {
+ private:
+  std::deque<T> items_;
+  std::mutex mutex_;
+  std::condition_variable available_;
+  bool closed_;
+
+ public:
+  WorkQueue(){ closed_ = false; }
+
+  void push(const T& item){
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      items_.push_back(item);
+    }
+    available_.notify_one();
+  }
+
+  bool pop(T& item){
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (items_.empty() && !closed_)
+      available_.wait(lock);
+    if (items_.empty())
+      return false;
+    item = items_.front();
+    items_.pop_front();
+    return true;
+  }
+
+  void close(){
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    available_.notify_all();
+  }
+};
+
+#endif